@@ -0,0 +1,281 @@
+// StarTrails 基准测试：生成合成星空序列，逐阶段计时，结果输出为 JSON 便于跨版本对比
+#include "MainWindow.h"
+#include "TrailEngine.h"
+#include "CompositeKernels.h"
+#include "OclTrailPipeline.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTextStream>
+#include <opencv2/imgproc.hpp>
+
+static QTextStream &out() { static QTextStream s(stdout); return s; }
+
+// --- 合成星空生成器 ---
+// 星点绕画面上方外侧的天极旋转，叠加高斯背景噪声与静止的地景剪影，帧序号决定内容(可复现)
+class StarFieldGenerator {
+public:
+    StarFieldGenerator(int w, int h, int depth, int starCount, unsigned seed, float noiseMean = 18.0f, float noiseSigma = 4.0f)
+        : m_w(w), m_h(h), m_depth(depth), m_noiseMean(noiseMean), m_noiseSigma(noiseSigma) {
+        cv::RNG rng(seed); m_pole = cv::Point2f(w * 0.5f, -h * 0.2f);
+        float maxR = std::hypot((float)w, (float)h * 1.2f);
+        for (int i = 0; i < starCount; ++i) {
+            Star s; s.radius = rng.uniform(0.05f, 1.0f) * maxR; s.angle = rng.uniform(0.0f, (float)CV_PI);
+            float b = rng.uniform(0.0f, 1.0f); s.brightness = 60.0f + 195.0f * b * b * b; s.size = b > 0.97f ? 2 : 1;
+            m_stars.push_back(s);
+        }
+    }
+    cv::Mat frame(int index) const {
+        float scale = m_depth == 16 ? 257.0f : 1.0f; int type = m_depth == 16 ? CV_16UC3 : CV_8UC3;
+        cv::Mat img(m_h, m_w, type);
+        cv::RNG rng(0x9E3779B9u + (unsigned)index);
+        rng.fill(img, cv::RNG::NORMAL, cv::Scalar::all(m_noiseMean * scale), cv::Scalar::all(m_noiseSigma * scale));
+        float dTheta = 0.0006f * index;
+        for (const Star &s : m_stars) {
+            cv::Point2f p(m_pole.x + s.radius * std::cos(s.angle + dTheta), m_pole.y + s.radius * std::sin(s.angle + dTheta));
+            if (p.x < 0 || p.y < 0 || p.x >= m_w || p.y >= m_h * 0.85f) continue;
+            cv::circle(img, cv::Point(cvRound(p.x), cvRound(p.y)), s.size, cv::Scalar(s.brightness * 0.95, s.brightness, s.brightness * 0.9) * scale, -1, cv::LINE_AA);
+        }
+        img(cv::Rect(0, (int)(m_h * 0.85f), m_w, m_h - (int)(m_h * 0.85f))) *= 0.3;
+        return img;
+    }
+private:
+    struct Star { float radius, angle, brightness; int size; };
+    int m_w, m_h, m_depth;
+    float m_noiseMean, m_noiseSigma;
+    cv::Point2f m_pole;
+    std::vector<Star> m_stars;
+};
+
+// --- 计时 ---
+struct StageResult {
+    QString name; double totalMs = 0; int frames = 0; bool skipped = false; QString note;
+    QJsonObject toJson() const {
+        QJsonObject o; o["totalMs"] = totalMs; o["frames"] = frames;
+        o["msPerFrame"] = frames > 0 ? totalMs / frames : 0.0; o["fps"] = totalMs > 0 ? frames * 1000.0 / totalMs : 0.0;
+        if (skipped) o["skipped"] = true; if (!note.isEmpty()) o["note"] = note;
+        return o;
+    }
+};
+
+static double elapsedMs(const QElapsedTimer &t) { return t.nsecsElapsed() / 1.0e6; }
+
+static cv::Mat to8Bit(const cv::Mat &m) { if (m.depth() == CV_8U) return m; cv::Mat t; m.convertTo(t, CV_8UC3, 255.0/65535.0); return t; }
+
+// 加权的 OpenCV 参照：8 位与原实现相同用 convertScaleAbs，16 位保持位深用 convertTo
+static void scaleRef(const cv::Mat &src, cv::Mat &dst, float w) { if (src.depth() == CV_8U) cv::convertScaleAbs(src, dst, w); else src.convertTo(dst, src.type(), w); }
+
+// 原 ProcessorThread 彗星分支：逐帧 convertScaleAbs + max，用作基准与逐位校验的参照
+static void referenceComet(const std::deque<cv::Mat> &buffer, const std::vector<float> &weights, int trailLength, cv::Mat &out) {
+    size_t bLen = buffer.size(); if (bLen <= 1) { buffer.back().copyTo(out); return; }
+    int off = trailLength - (int)bLen; cv::Mat accum; scaleRef(buffer[0], accum, weights[off]); cv::Mat tmp;
+    for (size_t k = 1; k < bLen; ++k) { float w = weights[off + k]; if (w > 0.99f) cv::max(accum, buffer[k], accum); else { scaleRef(buffer[k], tmp, w); cv::max(accum, tmp, accum); } }
+    out = accum;
+}
+
+// 融合内核与 OpenCV 路径逐位比对 (每个可用指令集)
+static bool checkKernels(const std::vector<cv::Mat> &frames, QJsonObject &report) {
+    bool allOk = true; CompositeKernels::Isa saved = CompositeKernels::activeIsa();
+    for (int isa = CompositeKernels::IsaScalar; isa <= (int)CompositeKernels::bestIsa(); ++isa) {
+        CompositeKernels::setIsa((CompositeKernels::Isa)isa); long long mismatches = 0;
+        for (size_t i = 1; i < frames.size(); ++i) {
+            float w = 0.05f + 0.95f * (float)(i % 23) / 22.0f;
+            cv::Mat fused = frames[i - 1].clone(), ref = frames[i - 1].clone(), tmp;
+            CompositeKernels::weightedMax(frames[i], w, fused);
+            scaleRef(frames[i], tmp, w); cv::max(ref, tmp, ref);
+            mismatches += cv::countNonZero(fused.reshape(1) != ref.reshape(1));
+        }
+        report[CompositeKernels::isaName((CompositeKernels::Isa)isa)] = (double)mismatches; if (mismatches) allOk = false;
+    }
+    CompositeKernels::setIsa(saved);
+    return allOk;
+}
+
+struct BenchConfig { QString label; int width, height, depth, frames, trail; bool disk; QString dir; int readAhead, decodeThreads, compositeThreads, historyTolerance; QString encoder; };
+
+static QJsonObject runBenchmark(const BenchConfig &cfg, bool &checksOk) {
+    out() << QString("== %1 (%2x%3, %4-bit, %5 帧, %6) ==").arg(cfg.label).arg(cfg.width).arg(cfg.height).arg(cfg.depth).arg(cfg.frames).arg(cfg.disk ? "disk" : "memory") << Qt::endl;
+    StarFieldGenerator gen(cfg.width, cfg.height, cfg.depth, cfg.width * cfg.height / 2000, 42);
+    QList<StageResult> stages; QElapsedTimer t;
+    QTemporaryDir tmp(cfg.dir.isEmpty() ? QDir::temp().filePath("startrails_bench_XXXXXX") : QDir(cfg.dir).filePath("startrails_bench_XXXXXX"));
+
+    // 内存中只保留有限的不同帧，循环使用，避免 8K 长序列占满内存
+    int unique = std::min(cfg.frames, 16); std::vector<cv::Mat> frames;
+    for (int i = 0; i < unique; ++i) frames.push_back(gen.frame(i)); // 保持源位深，合成按位深走各自的内核
+    auto frameAt = [&](int i) -> const cv::Mat & { return frames[i % unique]; };
+
+    // 1. customImread / 2. FrameProvider::read
+    StageResult sImread{"customImread"}, sProvider{"FrameProvider::read"};
+    if (cfg.disk && tmp.isValid()) {
+        QStringList files; QString ext = cfg.depth == 16 ? ".tif" : ".jpg";
+        for (int i = 0; i < cfg.frames; ++i) { QString f = tmp.filePath(QString("frame_%1%2").arg(i, 5, 10, QChar('0')).arg(ext)); cv::imwrite(f.toStdString(), gen.frame(i)); files << f; }
+        t.start(); for (const QString &f : files) { cv::Mat m = customImread(f); if (!m.empty()) sImread.frames++; } sImread.totalMs = elapsedMs(t);
+        FrameProvider provider; t.start();
+        if (provider.openSequence(files)) { provider.setReadAhead(cfg.readAhead, cfg.decodeThreads); provider.setNativeDepth(true); cv::Mat m; while (provider.read(m)) sProvider.frames++; }
+        sProvider.totalMs = elapsedMs(t); sProvider.note = QString("readAhead=%1 decodeThreads=%2").arg(cfg.readAhead).arg(cfg.decodeThreads);
+    } else { sImread.skipped = sProvider.skipped = true; }
+    stages << sImread << sProvider;
+
+    // 3. 无限模式：逐帧 max 累积
+    StageResult sInf{"composite.infinite"}; cv::Mat accum; t.start();
+    for (int i = 0; i < cfg.frames; ++i) { if (accum.empty()) accum = frameAt(i).clone(); else CompositeKernels::maxTiled(frameAt(i), accum, cfg.compositeThreads); sInf.frames++; }
+    sInf.totalMs = elapsedMs(t); sInf.note = QString("threads=%1").arg(CompositeKernels::effectiveThreads(cfg.compositeThreads)); stages << sInf;
+
+    // 3b. 无限模式跳块：摘要(块最大值)计入耗时，结果须与 3 逐位一致
+    StageResult sSkip{"composite.infinite.skip"}; cv::Mat accumSkip; std::vector<ushort> frameHi, accumLo; size_t blocks = 0, skipped = 0; t.start();
+    for (int i = 0; i < cfg.frames; ++i) {
+        if (accumSkip.empty()) accumSkip = frameAt(i).clone();
+        else { CompositeKernels::blockMax(frameAt(i), frameHi, cfg.compositeThreads); skipped += CompositeKernels::maxTiledSkip(frameAt(i), frameHi, accumSkip, accumLo, cfg.compositeThreads); blocks += CompositeKernels::summaryBlocks(accumSkip); }
+        sSkip.frames++;
+    }
+    sSkip.totalMs = elapsedMs(t); long long skipMismatch = cv::countNonZero(accum.reshape(1) != accumSkip.reshape(1));
+    sSkip.note = QString("skipped %1% of blocks").arg(blocks ? 100.0 * skipped / blocks : 0.0, 0, 'f', 1); stages << sSkip;
+
+    // 4. 彗星模式：TrailEngine 与原始逐帧合成对比，并逐位校验
+    StageResult sComet{"composite.comet"}, sCometRef{"composite.comet.reference"};
+    TrailEngine engine; engine.reset(cfg.trail, 0.85); engine.setThreads(cfg.compositeThreads); std::vector<cv::Mat> engineOut; int checkFrom = std::max(0, cfg.frames - 4);
+    t.start(); for (int i = 0; i < cfg.frames; ++i) { engine.push(frameAt(i).clone()); sComet.frames++; if (i >= checkFrom) engineOut.push_back(engine.output().clone()); }
+    sComet.totalMs = elapsedMs(t); sComet.note = QString("trail=%1 %2 threads=%3 tile=%4").arg(cfg.trail).arg(engine.isIncremental() ? "incremental" : "fold").arg(engine.threads()).arg(engine.tileElems());
+    std::deque<cv::Mat> buffer; std::vector<float> weights; float fadeStart = std::max(0.05, 1.0 - 0.85);
+    for (int i = 0; i < cfg.trail; ++i) { float tt = (float)i / std::max(1, cfg.trail - 1); weights.push_back(fadeStart + tt * (1.0f - fadeStart)); }
+    long long cometMismatch = 0; t.start();
+    for (int i = 0; i < cfg.frames; ++i) {
+        buffer.push_back(frameAt(i).clone()); if (buffer.size() > (size_t)cfg.trail) buffer.pop_front();
+        cv::Mat ref; referenceComet(buffer, weights, cfg.trail, ref); sCometRef.frames++;
+        if (i >= checkFrom) cometMismatch += cv::countNonZero(ref.reshape(1) != engineOut[i - checkFrom].reshape(1));
+    }
+    sCometRef.totalMs = elapsedMs(t); stages << sComet << sCometRef;
+
+    // 4a. 高 ISO / 光污染天空：噪声大时候选栈频繁溢出，记录逐帧扫描占比与引擎最终选择的路径
+    StageResult sNoisy{"composite.comet.noisy"}; StarFieldGenerator noisyGen(cfg.width, cfg.height, cfg.depth, cfg.width * cfg.height / 2000, 42, 40.0f, 12.0f);
+    std::vector<cv::Mat> noisyFrames; for (int i = 0; i < unique; ++i) noisyFrames.push_back(noisyGen.frame(i));
+    TrailEngine noisy; noisy.reset(cfg.trail, 0.85); noisy.setThreads(cfg.compositeThreads); std::deque<cv::Mat> noisyBuf; t.start();
+    for (int i = 0; i < cfg.frames; ++i) {
+        noisy.push(noisyFrames[i % unique].clone()); sNoisy.frames++;
+        if (i >= checkFrom) {
+            sNoisy.totalMs += elapsedMs(t); cv::Mat got = noisy.output().clone(), ref;
+            for (int k = std::max(0, i - cfg.trail + 1); k <= i; ++k) noisyBuf.push_back(noisyFrames[k % unique]);
+            referenceComet(noisyBuf, weights, cfg.trail, ref); noisyBuf.clear(); cometMismatch += cv::countNonZero(ref.reshape(1) != got.reshape(1)); t.start();
+        }
+    }
+    sNoisy.totalMs += elapsedMs(t);
+    sNoisy.note = QString("trail=%1 %2 dirty scans %3%").arg(cfg.trail).arg(noisy.switchedToFold() ? "incremental->fold" : (noisy.isIncremental() ? "incremental" : "fold")).arg(100.0 * noisy.dirtyScanRate(), 0, 'f', 2);
+    stages << sNoisy; noisyFrames.clear();
+
+    // 4b. OpenCL 设备常驻流水线 (输出 8 位，16 位输入时与量化后的 CPU 结果比较，容差 1)
+    StageResult sOcl{"composite.comet.opencl"}; long long oclMismatch = 0; OclTrailPipeline ocl;
+    if (ocl.reset(cfg.trail, 0.85, cv::Size(cfg.width, cfg.height))) {
+        std::vector<cv::Mat> oclOut; cv::Mat ready; t.start();
+        for (int i = 0; i < cfg.frames; ++i) { if (ocl.push(frameAt(i), ready)) { sOcl.frames++; if (i - 1 >= checkFrom) oclOut.push_back(ready.clone()); } }
+        if (ocl.flush(ready)) { sOcl.frames++; oclOut.push_back(ready.clone()); }
+        sOcl.totalMs = elapsedMs(t);
+        if (!ocl.isValid() || oclOut.size() != engineOut.size()) oclMismatch = -1;
+        else for (size_t k = 0; k < oclOut.size(); ++k) {
+            cv::Mat ref = engineOut[k]; if (ref.depth() == CV_16U) ref.convertTo(ref, CV_8U, 255.0 / 65535.0);
+            cv::Mat diff; cv::absdiff(ref, oclOut[k], diff); oclMismatch += cv::countNonZero(diff.reshape(1) > (cfg.depth == 16 ? 1 : 0));
+        }
+        sOcl.note = QString::fromStdString(cv::ocl::Device::getDefault().name());
+    } else { sOcl.skipped = true; }
+    stages << sOcl;
+
+    // 4c. 压缩拖尾历史：与完整帧结果之差不超过误差上限
+    StageResult sSparse{"composite.comet.sparse"}; int sparseErr = 0, sparseBound = cfg.historyTolerance * (cfg.depth == 16 ? 257 : 1);
+    TrailEngine sparse; sparse.setHistoryTolerance(cfg.historyTolerance); sparse.reset(cfg.trail, 0.85); sparse.setThreads(cfg.compositeThreads); t.start();
+    for (int i = 0; i < cfg.frames; ++i) {
+        sparse.push(frameAt(i).clone()); sSparse.frames++;
+        if (i >= checkFrom) { cv::Mat d; double e; cv::absdiff(sparse.output(), engineOut[i - checkFrom], d); cv::minMaxLoc(d.reshape(1), nullptr, &e); sparseErr = std::max(sparseErr, (int)e); }
+    }
+    sSparse.totalMs = elapsedMs(t);
+    sSparse.note = QString("tolerance=%1 history %2 MB (full %3 MB)").arg(cfg.historyTolerance).arg(sparse.peakHistoryBytes() / 1048576.0, 0, 'f', 1).arg(engine.peakHistoryBytes() / 1048576.0, 0, 'f', 1);
+    stages << sSparse;
+
+    // 5. 预览生成 (与 ProcessorThread 相同：360p 最近邻缩放 + QImage)
+    StageResult sPrev{"preview"}; int p_h = 360, p_w = (int)(cfg.width * ((double)p_h / cfg.height)); t.start();
+    for (int i = 0; i < cfg.frames; ++i) { cv::Mat small; cv::resize(frameAt(i), small, cv::Size(p_w, p_h), 0, 0, cv::INTER_NEAREST); QImage img = matToQImage(small); if (!img.isNull()) sPrev.frames++; }
+    sPrev.totalMs = elapsedMs(t); stages << sPrev;
+
+    // 6. VideoWriterWorker 编码 / 7. MotionPhotoMuxer::mux
+    StageResult sEnc{"VideoWriterWorker"}, sMux{"MotionPhotoMuxer::mux"};
+    if (tmp.isValid()) {
+        QString mp4 = tmp.filePath("bench.mp4"); int h = std::min(cfg.height, 1080); int w = (int)(cfg.width * ((double)h / cfg.height));
+        t.start(); VideoWriterWorker *writer = new VideoWriterWorker(mp4, w, h, 30.0, false);
+        EncoderSettings enc; enc.backend = EncoderSettings::backendFromString(cfg.encoder); writer->setEncoder(enc); writer->start();
+        for (int i = 0; i < cfg.frames; ++i) { writer->addFrame(frameAt(i)); sEnc.frames++; }
+        writer->stop(); WriterQueueStats ws = writer->stats(); delete writer; sEnc.totalMs = elapsedMs(t);
+        sEnc.note = QString("%5 %1x%2, producer stall %3 ms, consumer idle %4 ms").arg(w).arg(h).arg(ws.producerStallMs, 0, 'f', 1).arg(ws.consumerIdleMs, 0, 'f', 1).arg(cfg.encoder);
+        QString jpg = tmp.filePath("cover.jpg"); cv::imwrite(jpg.toStdString(), to8Bit(frameAt(cfg.frames - 1)));
+        t.start(); bool ok = MotionPhotoMuxer::mux(jpg, mp4, tmp.filePath("motion.jpg")); sMux.totalMs = elapsedMs(t); sMux.frames = ok ? 1 : 0;
+        sMux.note = QString("mp4 %1 bytes").arg(QFileInfo(mp4).size());
+    } else { sEnc.skipped = sMux.skipped = true; }
+    stages << sEnc << sMux;
+
+    QJsonObject run; run["label"] = cfg.label; run["width"] = cfg.width; run["height"] = cfg.height; run["depth"] = cfg.depth;
+    run["frames"] = cfg.frames; run["trailLength"] = cfg.trail; run["storage"] = cfg.disk ? "disk" : "memory";
+    QJsonObject st; for (const StageResult &s : stages) {
+        st[s.name] = s.toJson();
+        out() << QString("  %1 %2").arg(s.name, -28).arg(s.skipped ? QString("skipped") : QString("%1 ms/帧  %2 FPS").arg(s.frames ? s.totalMs / s.frames : 0.0, 8, 'f', 2).arg(s.totalMs > 0 ? s.frames * 1000.0 / s.totalMs : 0.0, 8, 'f', 1)) << Qt::endl;
+    }
+    run["stages"] = st;
+    QJsonObject checks, kernels; bool kOk = checkKernels(frames, kernels);
+    checks["kernelMismatches"] = kernels; checks["cometMismatches"] = (double)cometMismatch;
+    if (!sOcl.skipped) checks["openclMismatches"] = (double)oclMismatch;
+    checks["skipMismatches"] = (double)skipMismatch;
+    checks["sparseMaxError"] = sparseErr; checks["sparseErrorBound"] = sparseBound;
+    bool passed = kOk && cometMismatch == 0 && (sOcl.skipped || oclMismatch == 0) && sparseErr <= sparseBound && skipMismatch == 0; checks["passed"] = passed;
+    run["checks"] = checks; if (!passed) { checksOk = false; out() << "  !! 逐位校验失败" << Qt::endl; }
+    return run;
+}
+
+static bool parseResolution(const QString &s, QString &label, int &w, int &h) {
+    QString r = s.trimmed().toLower(); label = r;
+    if (r == "720p") { w = 1280; h = 720; } else if (r == "1080p") { w = 1920; h = 1080; } else if (r == "4k") { w = 3840; h = 2160; } else if (r == "8k") { w = 7680; h = 4320; }
+    else { QStringList p = r.split('x'); if (p.size() != 2) return false; w = p[0].toInt(); h = p[1].toInt(); }
+    return w > 0 && h > 0;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser; parser.setApplicationDescription("StarTrails 基准测试"); parser.addHelpOption();
+    QCommandLineOption optRes("resolutions", "分辨率列表: 720p,1080p,4k,8k 或 WxH", "list", "1080p,4k");
+    QCommandLineOption optDepth("depths", "源位深列表: 8,16", "list", "8");
+    QCommandLineOption optFrames("frames", "每组帧数", "n", "48");
+    QCommandLineOption optTrail("trail", "彗星拖尾长度", "n", "24");
+    QCommandLineOption optStorage("storage", "序列存储: disk 或 memory", "mode", "disk");
+    QCommandLineOption optDir("dir", "disk 模式的临时目录", "path");
+    QCommandLineOption optReadAhead("read-ahead", "FrameProvider 预读深度", "n", "8");
+    QCommandLineOption optThreads("decode-threads", "解码线程数", "n", QString::number(std::max(1, QThread::idealThreadCount() / 2)));
+    QCommandLineOption optOut("output", "JSON 结果文件", "file", "bench_results.json");
+    QCommandLineOption optCompThreads("composite-threads", "分块合成线程数 (0 = 全部核心)", "n", "0");
+    QCommandLineOption optEncoder("encoder", "编码后端: opencv 或 ffmpeg", "name", "opencv");
+    QCommandLineOption optHistTol("history-tolerance", "压缩拖尾历史的误差上限 (8 位灰阶)", "n", "2");
+    parser.addOptions({optRes, optDepth, optFrames, optTrail, optStorage, optDir, optReadAhead, optThreads, optCompThreads, optEncoder, optHistTol, optOut});
+    parser.process(app);
+
+    QJsonArray runs; bool checksOk = true;
+    for (const QString &res : parser.value(optRes).split(',', Qt::SkipEmptyParts)) {
+        BenchConfig cfg; if (!parseResolution(res, cfg.label, cfg.width, cfg.height)) { out() << "无效分辨率: " << res << Qt::endl; return 2; }
+        for (const QString &d : parser.value(optDepth).split(',', Qt::SkipEmptyParts)) {
+            cfg.depth = d.trimmed().toInt() == 16 ? 16 : 8; cfg.frames = std::max(2, parser.value(optFrames).toInt()); cfg.trail = std::max(1, parser.value(optTrail).toInt());
+            cfg.disk = parser.value(optStorage) != "memory"; cfg.dir = parser.value(optDir);
+            cfg.readAhead = parser.value(optReadAhead).toInt(); cfg.decodeThreads = parser.value(optThreads).toInt(); cfg.compositeThreads = parser.value(optCompThreads).toInt(); cfg.encoder = parser.value(optEncoder).toLower(); cfg.historyTolerance = std::max(0, parser.value(optHistTol).toInt());
+            runs.append(runBenchmark(cfg, checksOk));
+        }
+    }
+
+    QJsonObject root; root["version"] = STARTRAILS_VERSION; root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["opencv"] = CV_VERSION; root["threads"] = QThread::idealThreadCount(); root["isa"] = CompositeKernels::isaName(CompositeKernels::bestIsa());
+    root["runs"] = runs;
+    QFile f(parser.value(optOut));
+    if (!f.open(QIODevice::WriteOnly)) { out() << "无法写入 " << f.fileName() << Qt::endl; return 2; }
+    f.write(QJsonDocument(root).toJson()); f.close();
+    out() << "结果已写入 " << f.fileName() << Qt::endl;
+    return checksOk ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#include "CompositeKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STARTRAILS_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC/Clang 需要逐函数开启目标指令集；MSVC 无需额外标志即可使用内建函数
+#if defined(__GNUC__) || defined(__clang__)
+#define STARTRAILS_TARGET(x) __attribute__((target(x)))
+#else
+#define STARTRAILS_TARGET(x)
+#endif
+
+// ================= 各指令集实现 =================
+// 取整与 OpenCV 一致：cvRound / v_round 都是就近取偶 (MXCSR 默认模式)
+static void weightedMaxScalar(const uchar *src, uchar *acc, int n, float w) {
+    for (int i = 0; i < n; ++i) { uchar v = cv::saturate_cast<uchar>(std::abs((float)src[i] * w)); if (v > acc[i]) acc[i] = v; }
+}
+
+static void weightedMaxScalar16(const ushort *src, ushort *acc, int n, float w) {
+    for (int i = 0; i < n; ++i) { ushort v = cv::saturate_cast<ushort>(std::abs((float)src[i] * w)); if (v > acc[i]) acc[i] = v; }
+}
+
+#ifdef STARTRAILS_X86
+STARTRAILS_TARGET("sse4.1")
+static void weightedMaxSSE41(const uchar *src, uchar *acc, int n, float w) {
+    const __m128 vw = _mm_set1_ps(w); const __m128 sign = _mm_set1_ps(-0.0f); int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(s)), vw);
+        __m128 f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(s, 4))), vw);
+        __m128 f2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(s, 8))), vw);
+        __m128 f3 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(s, 12))), vw);
+        __m128i q0 = _mm_cvtps_epi32(_mm_andnot_ps(sign, f0)), q1 = _mm_cvtps_epi32(_mm_andnot_ps(sign, f1));
+        __m128i q2 = _mm_cvtps_epi32(_mm_andnot_ps(sign, f2)), q3 = _mm_cvtps_epi32(_mm_andnot_ps(sign, f3));
+        __m128i r = _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_max_epu8(a, r));
+    }
+    weightedMaxScalar(src + i, acc + i, n - i, w);
+}
+
+STARTRAILS_TARGET("sse4.1")
+static void weightedMaxSSE41_16(const ushort *src, ushort *acc, int n, float w) {
+    const __m128 vw = _mm_set1_ps(w); const __m128 sign = _mm_set1_ps(-0.0f); int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(s)), vw);
+        __m128 f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(s, 8))), vw);
+        __m128i r = _mm_packus_epi32(_mm_cvtps_epi32(_mm_andnot_ps(sign, f0)), _mm_cvtps_epi32(_mm_andnot_ps(sign, f1)));
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_max_epu16(a, r));
+    }
+    weightedMaxScalar16(src + i, acc + i, n - i, w);
+}
+
+STARTRAILS_TARGET("avx2")
+static void weightedMaxAVX2(const uchar *src, uchar *acc, int n, float w) {
+    const __m256 vw = _mm256_set1_ps(w); const __m256 sign = _mm256_set1_ps(-0.0f); int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m256 f0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(s)), vw);
+        __m256 f1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(s, 8))), vw);
+        __m256i q0 = _mm256_cvtps_epi32(_mm256_andnot_ps(sign, f0)), q1 = _mm256_cvtps_epi32(_mm256_andnot_ps(sign, f1));
+        // packs 在 128 位通道内交错，需要 permute 恢复顺序
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8);
+        __m128i r = _mm_packus_epi16(_mm256_castsi256_si128(p), _mm256_extracti128_si256(p, 1));
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_max_epu8(a, r));
+    }
+    weightedMaxScalar(src + i, acc + i, n - i, w);
+}
+
+STARTRAILS_TARGET("avx2")
+static void weightedMaxAVX2_16(const ushort *src, ushort *acc, int n, float w) {
+    const __m256 vw = _mm256_set1_ps(w); const __m256 sign = _mm256_set1_ps(-0.0f); int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256 f0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(s))), vw);
+        __m256 f1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1))), vw);
+        __m256i q0 = _mm256_cvtps_epi32(_mm256_andnot_ps(sign, f0)), q1 = _mm256_cvtps_epi32(_mm256_andnot_ps(sign, f1));
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), 0xD8);
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_max_epu16(a, r));
+    }
+    weightedMaxScalar16(src + i, acc + i, n - i, w);
+}
+
+STARTRAILS_TARGET("avx512f")
+static void weightedMaxAVX512(const uchar *src, uchar *acc, int n, float w) {
+    const __m512 vw = _mm512_set1_ps(w); const __m512i absMask = _mm512_set1_epi32(0x7FFFFFFF); int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m512 f = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(s)), vw);
+        f = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(f), absMask));
+        __m128i r = _mm512_cvtusepi32_epi8(_mm512_cvtps_epi32(f));
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_max_epu8(a, r));
+    }
+    weightedMaxScalar(src + i, acc + i, n - i, w);
+}
+
+STARTRAILS_TARGET("avx512f")
+static void weightedMaxAVX512_16(const ushort *src, ushort *acc, int n, float w) {
+    const __m512 vw = _mm512_set1_ps(w); const __m512i absMask = _mm512_set1_epi32(0x7FFFFFFF); int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m512 f = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(s)), vw);
+        f = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(f), absMask));
+        __m256i r = _mm512_cvtusepi32_epi16(_mm512_cvtps_epi32(f));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_max_epu16(a, r));
+    }
+    weightedMaxScalar16(src + i, acc + i, n - i, w);
+}
+#endif
+
+// ================= CompositeKernels Implementation =================
+// 按像素类型在编译期选择内核表，每行只做一次函数指针调用，像素循环内没有类型分支
+template <typename T> struct KernelTable;
+template <> struct KernelTable<uchar> {
+    typedef void (*Fn)(const uchar*, uchar*, int, float);
+    static Fn get(CompositeKernels::Isa isa) {
+#ifdef STARTRAILS_X86
+        switch (isa) {
+        case CompositeKernels::IsaAVX512: return weightedMaxAVX512;
+        case CompositeKernels::IsaAVX2: return weightedMaxAVX2;
+        case CompositeKernels::IsaSSE41: return weightedMaxSSE41;
+        default: break;
+        }
+#endif
+        (void)isa; return weightedMaxScalar;
+    }
+};
+template <> struct KernelTable<ushort> {
+    typedef void (*Fn)(const ushort*, ushort*, int, float);
+    static Fn get(CompositeKernels::Isa isa) {
+#ifdef STARTRAILS_X86
+        switch (isa) {
+        case CompositeKernels::IsaAVX512: return weightedMaxAVX512_16;
+        case CompositeKernels::IsaAVX2: return weightedMaxAVX2_16;
+        case CompositeKernels::IsaSSE41: return weightedMaxSSE41_16;
+        default: break;
+        }
+#endif
+        (void)isa; return weightedMaxScalar16;
+    }
+};
+
+template <typename T>
+static void weightedMaxMat(const cv::Mat &frame, float w, cv::Mat &accum, CompositeKernels::Isa isa) {
+    typename KernelTable<T>::Fn fn = KernelTable<T>::get(isa);
+    int rowLen = frame.cols * frame.channels(); int rows = frame.rows;
+    if (frame.isContinuous() && accum.isContinuous()) { rowLen *= rows; rows = 1; }
+    for (int y = 0; y < rows; ++y) fn(frame.ptr<T>(y), accum.ptr<T>(y), rowLen, w);
+}
+
+static std::atomic<int> &activeIsaRef() { static std::atomic<int> isa((int)CompositeKernels::bestIsa()); return isa; }
+
+CompositeKernels::Isa CompositeKernels::bestIsa() {
+#ifdef STARTRAILS_X86
+    if (cv::checkHardwareSupport(CV_CPU_AVX_512F)) return IsaAVX512;
+    if (cv::checkHardwareSupport(CV_CPU_AVX2)) return IsaAVX2;
+    if (cv::checkHardwareSupport(CV_CPU_SSE4_1)) return IsaSSE41;
+#endif
+    return IsaScalar;
+}
+CompositeKernels::Isa CompositeKernels::activeIsa() { return (Isa)activeIsaRef().load(); }
+void CompositeKernels::setIsa(Isa isa) { activeIsaRef().store((int)std::min(isa, bestIsa())); }
+const char *CompositeKernels::isaName(Isa isa) {
+    switch (isa) { case IsaAVX512: return "AVX-512"; case IsaAVX2: return "AVX2"; case IsaSSE41: return "SSE4.1"; default: return "Scalar"; }
+}
+
+void CompositeKernels::weightedMaxRow(const uchar *src, uchar *acc, int n, float w) { KernelTable<uchar>::get(activeIsa())(src, acc, n, w); }
+void CompositeKernels::weightedMaxRow(const ushort *src, ushort *acc, int n, float w) { KernelTable<ushort>::get(activeIsa())(src, acc, n, w); }
+
+void CompositeKernels::weightedMax(const cv::Mat &frame, float w, cv::Mat &accum) {
+    CV_Assert((frame.depth() == CV_8U || frame.depth() == CV_16U) && frame.size() == accum.size() && frame.type() == accum.type());
+    if (frame.depth() == CV_16U) weightedMaxMat<ushort>(frame, w, accum, activeIsa());
+    else weightedMaxMat<uchar>(frame, w, accum, activeIsa());
+}
+
+// ================= 分块并行 =================
+size_t CompositeKernels::tileElems(size_t bytesPerElem) {
+    size_t e = kTileBytes / std::max<size_t>(1, bytesPerElem);
+    return std::max<size_t>(64, e & ~(size_t)63); // 块边界对齐到 64 元素，SIMD 主循环不被切碎
+}
+
+int CompositeKernels::effectiveThreads(int threads) {
+    int pool = std::max(1, cv::getNumThreads()); // parallel_for_ 的并发上限
+    return threads <= 0 ? pool : std::min(threads, pool);
+}
+
+void CompositeKernels::parallelTiles(size_t n, size_t bytesPerElem, int threads, const std::function<void(size_t, size_t)> &fn) {
+    if (n == 0) return;
+    size_t tile = tileElems(bytesPerElem), nTiles = (n + tile - 1) / tile;
+    int workers = (int)std::min<size_t>(effectiveThreads(threads), nTiles);
+    if (workers <= 1) { for (size_t t = 0; t < nTiles; ++t) fn(t * tile, std::min(n, (t + 1) * tile)); return; }
+    // 每个 stripe 是一个工作线程，块按需领取，先做完的线程自动多领
+    std::atomic<size_t> next(0);
+    cv::parallel_for_(cv::Range(0, workers), [&](const cv::Range &) {
+        for (size_t t; (t = next.fetch_add(1)) < nTiles; ) fn(t * tile, std::min(n, (t + 1) * tile));
+    }, workers);
+}
+
+void CompositeKernels::maxTiled(const cv::Mat &frame, cv::Mat &accum, int threads) {
+    CV_Assert(frame.size() == accum.size() && frame.type() == accum.type());
+    if (!frame.isContinuous() || !accum.isContinuous()) { cv::max(accum, frame, accum); return; }
+    size_t esz = frame.elemSize1(); int type = CV_MAKETYPE(frame.depth(), 1);
+    parallelTiles(frame.total() * frame.channels(), esz * 2, threads, [&](size_t b, size_t e) {
+        cv::Mat a(1, (int)(e - b), type, accum.data + b * esz), f(1, (int)(e - b), type, (void*)(frame.data + b * esz));
+        cv::max(a, f, a);
+    });
+}
+
+// ================= 跳块摘要 =================
+// 块 [b, e) 的单通道视图；8/16 位统一按 ushort 保存摘要
+static cv::Mat blockView(const cv::Mat &m, size_t b, size_t e) {
+    return cv::Mat(1, (int)(e - b), CV_MAKETYPE(m.depth(), 1), (void*)(m.data + b * m.elemSize1()));
+}
+
+static void blockSummary(const cv::Mat &m, std::vector<ushort> &out, bool wantMax, int threads) {
+    CV_Assert(m.isContinuous() && (m.depth() == CV_8U || m.depth() == CV_16U));
+    const size_t n = m.total() * m.channels(), blocks = CompositeKernels::summaryBlocks(m), B = CompositeKernels::kSummaryElems;
+    out.resize(blocks);
+    CompositeKernels::parallelTiles(blocks, B * m.elemSize1(), threads, [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) { double lo, hi; cv::minMaxIdx(blockView(m, k * B, std::min(n, (k + 1) * B)), &lo, &hi); out[k] = (ushort)(wantMax ? hi : lo); }
+    });
+}
+
+void CompositeKernels::blockMax(const cv::Mat &frame, std::vector<ushort> &hi, int threads) { blockSummary(frame, hi, true, threads); }
+void CompositeKernels::blockMin(const cv::Mat &frame, std::vector<ushort> &lo, int threads) { blockSummary(frame, lo, false, threads); }
+
+size_t CompositeKernels::maxTiledSkip(const cv::Mat &frame, const std::vector<ushort> &frameHi, cv::Mat &accum, std::vector<ushort> &accumLo, int threads) {
+    CV_Assert(frame.size() == accum.size() && frame.type() == accum.type());
+    const size_t blocks = summaryBlocks(frame);
+    if (!frame.isContinuous() || !accum.isContinuous() || frameHi.size() != blocks) { maxTiled(frame, accum, threads); accumLo.clear(); return 0; }
+    if (accumLo.size() != blocks) blockMin(accum, accumLo, threads);
+    const size_t n = frame.total() * frame.channels(), B = kSummaryElems; std::atomic<size_t> skipped(0);
+    parallelTiles(blocks, B * frame.elemSize1() * 2, threads, [&](size_t b, size_t e) {
+        size_t local = 0;
+        for (size_t k = b; k < e; ++k) {
+            if (frameHi[k] <= accumLo[k]) { local++; continue; }
+            // 更新后的块最小值只可能变大，顺手重算
+            cv::Mat a = blockView(accum, k * B, std::min(n, (k + 1) * B)); cv::max(a, blockView(frame, k * B, std::min(n, (k + 1) * B)), a);
+            double lo; cv::minMaxIdx(a, &lo, nullptr); accumLo[k] = (ushort)lo;
+        }
+        skipped += local;
+    });
+    return skipped.load();
+}
@@ -0,0 +1,47 @@
+#ifndef COMPOSITEKERNELS_H
+#define COMPOSITEKERNELS_H
+
+#include <functional>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 合成内核 ---
+// 融合的加权最大值：accum = max(accum, saturate(|frame * w|))，支持 8 位与 16 位
+// 8 位时等价于 cv::convertScaleAbs(frame, tmp, w) + cv::max(accum, tmp, accum)，16 位时等价于
+// frame.convertTo(tmp, type, w) + cv::max，逐位一致，但只读写一遍内存、不需要临时帧。按 CPU 能力在运行时选择 AVX-512 / AVX2 / SSE4.1 / 标量实现。
+class CompositeKernels {
+public:
+    enum Isa { IsaScalar = 0, IsaSSE41, IsaAVX2, IsaAVX512 };
+
+    // frame/accum: 同尺寸、同类型的 8 位或 16 位图像
+    static void weightedMax(const cv::Mat &frame, float w, cv::Mat &accum);
+    static void weightedMaxRow(const uchar *src, uchar *acc, int n, float w);
+    static void weightedMaxRow(const ushort *src, ushort *acc, int n, float w);
+
+    // 分块并行：把 n 个元素切成约 kTileBytes 的块(bytesPerElem 为每个元素在一块内触及的总字节数)，
+    // threads 个工作线程从共享计数器领取块，每块由一个线程从头处理到尾，工作集留在 L2。threads <= 0 = 全部核心
+    static constexpr size_t kTileBytes = 256 * 1024;
+    static size_t tileElems(size_t bytesPerElem);
+    static int effectiveThreads(int threads);
+    static void parallelTiles(size_t n, size_t bytesPerElem, int threads, const std::function<void(size_t begin, size_t end)> &fn);
+    // accum = max(accum, frame)，按块并行 (无限模式)
+    static void maxTiled(const cv::Mat &frame, cv::Mat &accum, int threads);
+
+    // 跳块摘要：每 kSummaryElems 个元素一块，记录新帧的块最大值与累加器的块最小值。
+    // 新帧块最大值不超过累加器块最小值时 max 不会改变该块，整块跳过；结果与 maxTiled 逐位一致
+    static constexpr size_t kSummaryElems = 4096;
+    static size_t summaryBlocks(const cv::Mat &m) { return (m.total() * m.channels() + kSummaryElems - 1) / kSummaryElems; }
+    static void blockMax(const cv::Mat &frame, std::vector<ushort> &hi, int threads);
+    static void blockMin(const cv::Mat &frame, std::vector<ushort> &lo, int threads);
+    // frameHi 来自 blockMax(frame)；accumLo 与 accum 不匹配时先重建，之后随累加器增量更新。返回跳过的块数
+    static size_t maxTiledSkip(const cv::Mat &frame, const std::vector<ushort> &frameHi, cv::Mat &accum, std::vector<ushort> &accumLo, int threads);
+
+    static Isa bestIsa();          // 当前 CPU 支持的最高指令集
+    static Isa activeIsa();
+    static void setIsa(Isa isa);   // 强制指定实现(超出 CPU 能力时降级)，用于基准对比
+    static const char *isaName(Isa isa);
+};
+
+#endif // COMPOSITEKERNELS_H
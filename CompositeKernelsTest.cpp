@@ -0,0 +1,100 @@
+// CompositeKernels 单元测试：每个可用指令集的分派实现都与标量 / OpenCV 参照逐位比较
+// 覆盖 8/16 位、奇数尺寸、SIMD 主循环之后的尾部元素、非对齐起点与非连续 ROI。只依赖 OpenCV core，失败时退出码为 1
+#include "CompositeKernels.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static int g_failures = 0;
+
+static void expect(bool ok, const char *what, const char *isa, int depth, int n) {
+    if (ok) return;
+    g_failures++; std::printf("FAIL %-22s isa=%-7s depth=%2d n=%d\n", what, isa, depth, n);
+}
+
+static cv::Mat randomMat(int rows, int cols, int type, cv::RNG &rng) {
+    cv::Mat m(rows, cols, type); double hi = CV_MAT_DEPTH(type) == CV_16U ? 65536.0 : 256.0;
+    rng.fill(m, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(hi)); return m;
+}
+
+static bool equalMat(const cv::Mat &a, const cv::Mat &b) { return a.size() == b.size() && a.type() == b.type() && cv::countNonZero(a.reshape(1) != b.reshape(1)) == 0; }
+
+// 与 Benchmark 相同的参照：8 位 convertScaleAbs，16 位 convertTo (都是就近取偶 + 饱和)
+static void weightedRef(const cv::Mat &src, float w, cv::Mat &acc) {
+    cv::Mat tmp; if (src.depth() == CV_8U) cv::convertScaleAbs(src, tmp, w); else src.convertTo(tmp, src.type(), w);
+    cv::max(acc, tmp, acc);
+}
+
+// 权重覆盖 0.5 的取偶边界、> 1 的饱和与 1.0 直通
+static const float kWeights[] = { 0.05f, 0.15f, 0.5f, 0.73f, 0.99f, 1.0f, 1.7f };
+
+// 1. 行内核：n 从 0 覆盖到两个最宽向量(64 字节)之外，起点故意错开 1 个元素
+template <typename T>
+static void testRows(const char *isa, int depth, cv::RNG &rng) {
+    const int maxN = 150; cv::Mat src = randomMat(1, maxN + 1, CV_MAKETYPE(depth, 1), rng), acc0 = randomMat(1, maxN + 1, CV_MAKETYPE(depth, 1), rng);
+    for (float w : kWeights) for (int n = 0; n <= maxN; ++n) {
+        cv::Mat acc = acc0.clone(), ref = acc0.clone();
+        CompositeKernels::weightedMaxRow(src.ptr<T>() + 1, acc.ptr<T>() + 1, n, w);
+        if (n > 0) { cv::Mat r = ref.colRange(1, 1 + n); weightedRef(src.colRange(1, 1 + n), w, r); }
+        expect(equalMat(acc, ref), "weightedMaxRow", isa, depth == CV_16U ? 16 : 8, n);
+    }
+}
+
+// 2. 整帧内核：奇数宽高、1/3 通道、连续与非连续 (ROI) 两种布局
+static void testFrames(const char *isa, int depth, cv::RNG &rng) {
+    const cv::Size sizes[] = { cv::Size(1, 1), cv::Size(17, 3), cv::Size(333, 7), cv::Size(641, 481) };
+    for (const cv::Size &sz : sizes) for (int cn : { 1, 3 }) for (bool roi : { false, true }) {
+        int type = CV_MAKETYPE(depth, cn); cv::Mat bigF = randomMat(sz.height + 2, sz.width + 3, type, rng), bigA = randomMat(sz.height + 2, sz.width + 3, type, rng);
+        cv::Rect r = roi ? cv::Rect(1, 1, sz.width, sz.height) : cv::Rect(0, 0, sz.width, sz.height);
+        cv::Mat frame = roi ? bigF(r) : bigF(r).clone();
+        for (float w : kWeights) {
+            cv::Mat accHold = bigA.clone(), refHold = bigA.clone(); // ROI 时 acc 是大图的视图，保持非连续布局
+            cv::Mat acc = roi ? accHold(r) : accHold(r).clone(), ref = roi ? refHold(r) : refHold(r).clone();
+            CompositeKernels::weightedMax(frame, w, acc); weightedRef(frame, w, ref);
+            expect(equalMat(acc, ref) && equalMat(accHold, refHold), roi ? "weightedMax(roi)" : "weightedMax", isa, depth == CV_16U ? 16 : 8, (int)(sz.area() * cn));
+        }
+    }
+}
+
+// 3. 无限模式：分块 max、块摘要与跳块。尺寸跨越多个 tile，尾块不满；threads 1 与 3 都要一致
+static void testTiled(int depth, cv::RNG &rng) {
+    const cv::Size sizes[] = { cv::Size(7, 5), cv::Size(401, 373), cv::Size(1031, 257) };
+    for (const cv::Size &sz : sizes) for (int threads : { 1, 3 }) {
+        int type = CV_MAKETYPE(depth, 3); int bits = depth == CV_16U ? 16 : 8; cv::Mat accum = randomMat(sz.height, sz.width, type, rng), accumSkip = accum.clone();
+        std::vector<ushort> frameHi, accumLo;
+        for (int f = 0; f < 6; ++f) {
+            cv::Mat frame = randomMat(sz.height, sz.width, type, rng);
+            if (f % 2) frame(cv::Rect(0, 0, sz.width, sz.height / 2)).setTo(0); // 半幅全暗，制造可跳过的块
+            cv::Mat ref; cv::max(accum, frame, ref);
+            CompositeKernels::maxTiled(frame, accum, threads);
+            expect(equalMat(accum, ref), "maxTiled", "-", bits, (int)frame.total() * 3);
+
+            // blockMax 与逐块 minMaxIdx 一致；maxTiledSkip 增量维护的 accumLo 与重新统计的块最小值一致
+            CompositeKernels::blockMax(frame, frameHi, threads);
+            const size_t n = frame.total() * frame.channels(), B = CompositeKernels::kSummaryElems; bool sumOk = frameHi.size() == CompositeKernels::summaryBlocks(frame);
+            std::vector<ushort> freshLo; CompositeKernels::blockMin(accumSkip, freshLo, threads); sumOk = sumOk && (accumLo.empty() || accumLo == freshLo);
+            for (size_t k = 0; sumOk && k < frameHi.size(); ++k) {
+                cv::Mat fv = frame.reshape(1, 1).colRange((int)(k * B), (int)std::min(n, (k + 1) * B)), av = accumSkip.reshape(1, 1).colRange((int)(k * B), (int)std::min(n, (k + 1) * B));
+                double lo, hi; cv::minMaxIdx(fv, nullptr, &hi); cv::minMaxIdx(av, &lo, nullptr); sumOk = frameHi[k] == (ushort)hi && freshLo[k] == (ushort)lo;
+            }
+            expect(sumOk, "blockMax/blockMin", "-", bits, (int)n);
+            if (f == 3) accumLo.clear(); // 摘要失效后应自动重建
+            CompositeKernels::maxTiledSkip(frame, frameHi, accumSkip, accumLo, threads);
+            expect(equalMat(accumSkip, ref), "maxTiledSkip", "-", bits, (int)n);
+        }
+    }
+}
+
+int main() {
+    cv::RNG rng(20240611); CompositeKernels::Isa saved = CompositeKernels::activeIsa();
+    for (int isa = CompositeKernels::IsaScalar; isa <= (int)CompositeKernels::bestIsa(); ++isa) {
+        CompositeKernels::setIsa((CompositeKernels::Isa)isa); const char *name = CompositeKernels::isaName((CompositeKernels::Isa)isa);
+        testRows<uchar>(name, CV_8U, rng); testRows<ushort>(name, CV_16U, rng);
+        testFrames(name, CV_8U, rng); testFrames(name, CV_16U, rng);
+        std::printf("%-8s %s\n", name, g_failures ? "FAILED" : "ok");
+    }
+    CompositeKernels::setIsa(saved);
+    testTiled(CV_8U, rng); testTiled(CV_16U, rng);
+    std::printf("%d failure(s)\n", g_failures);
+    return g_failures ? 1 : 0;
+}
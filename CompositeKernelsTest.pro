@@ -0,0 +1,18 @@
+# CompositeKernels 单元测试 (命令行程序，不依赖 Qt)
+# 运行: CompositeKernelsTest，逐位校验失败时退出码为 1
+
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+
+TARGET = CompositeKernelsTest
+TEMPLATE = app
+
+# --- OpenCV 配置 ---
+include(opencv.pri)
+
+SOURCES += \
+    CompositeKernels.cpp \
+    CompositeKernelsTest.cpp
+
+HEADERS += \
+    CompositeKernels.h
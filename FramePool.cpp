@@ -0,0 +1,62 @@
+#include "FramePool.h"
+#include <QDebug>
+
+// ================= FramePool Implementation =================
+// 超出容量的缓冲用 userdata 标记，释放时直接归还给堆
+static void *const kOverflowTag = (void*)1;
+
+FramePool::FramePool(int capacity) : m_capacity(std::max(1, capacity)), m_allocated(0), m_reused(0), m_overflow(0) {}
+
+FramePool::~FramePool() {
+    std::lock_guard<std::mutex> l(m_mutex);
+    if ((int)m_free.size() != m_allocated) qDebug() << "FramePool: destroyed with" << m_allocated - (int)m_free.size() << "buffers still in use";
+    for (const Block &b : m_free) cv::fastFree(b.data);
+    m_free.clear();
+}
+
+cv::Mat FramePool::acquire(cv::Size size, int type) {
+    cv::Mat m; m.allocator = this; m.create(size, type); return m;
+}
+
+int FramePool::allocated() const { std::lock_guard<std::mutex> l(m_mutex); return m_allocated; }
+long long FramePool::reuseCount() const { std::lock_guard<std::mutex> l(m_mutex); return m_reused; }
+long long FramePool::overflowCount() const { std::lock_guard<std::mutex> l(m_mutex); return m_overflow; }
+
+// 与 OpenCV 默认分配器相同的步长计算，只是缓冲来自空闲列表
+cv::UMatData *FramePool::allocate(int dims, const int *sizes, int type, void *data0, size_t *step, cv::AccessFlag, cv::UMatUsageFlags) const {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) { if (data0 && step[i] != CV_AUTOSTEP) total = step[i]; else step[i] = total; }
+        total *= sizes[i];
+    }
+    cv::UMatData *u = new cv::UMatData(this); u->size = total;
+    if (data0) { u->data = u->origdata = (uchar*)data0; u->flags |= cv::UMatData::USER_ALLOCATED; return u; }
+
+    uchar *data = nullptr; uchar *evicted = nullptr;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        for (size_t i = 0; i < m_free.size(); ++i) {
+            if (m_free[i].size == total) { data = m_free[i].data; m_free[i] = m_free.back(); m_free.pop_back(); m_reused++; break; }
+        }
+        if (!data && m_allocated < m_capacity) m_allocated++;
+        else if (!data && !m_free.empty()) { evicted = m_free.back().data; m_free.pop_back(); } // 尺寸不符的空闲缓冲让位
+        else if (!data) { m_overflow++; u->userdata = kOverflowTag; }
+    }
+    if (evicted) cv::fastFree(evicted);
+    if (!data) data = (uchar*)cv::fastMalloc(total);
+    u->data = u->origdata = data;
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData *u, cv::AccessFlag, cv::UMatUsageFlags) const { return u != nullptr; }
+
+void FramePool::deallocate(cv::UMatData *u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0 && u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        if (u->userdata == kOverflowTag) cv::fastFree(u->origdata);
+        else { std::lock_guard<std::mutex> l(m_mutex); m_free.push_back({u->size, u->origdata}); }
+        u->origdata = nullptr;
+    }
+    delete u;
+}
@@ -0,0 +1,42 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <mutex>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 帧缓冲池 ---
+// 作为 cv::MatAllocator 使用：acquire() 返回的 Mat 与普通 Mat 一样按引用计数共享，
+// 最后一个引用释放时缓冲自动回到池中，供拖尾历史、合成输出与写入队列循环使用。
+// 池容量固定，超出容量时退化为普通堆分配并计入 overflow，不会阻塞渲染。
+// 注意：池必须比所有从它分配的 Mat 活得更久。
+class FramePool : public cv::MatAllocator {
+public:
+    explicit FramePool(int capacity);
+    ~FramePool() override;
+
+    cv::Mat acquire(cv::Size size, int type);
+
+    int capacity() const { return m_capacity; }
+    int allocated() const;           // 池当前拥有的缓冲数(含使用中)
+    long long reuseCount() const;    // 命中空闲缓冲的次数
+    long long overflowCount() const; // 超出容量的堆分配次数
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData *u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData *u) const override;
+
+private:
+    struct Block { size_t size; uchar *data; };
+
+    int m_capacity;
+    mutable std::mutex m_mutex;
+    mutable std::vector<Block> m_free;
+    mutable int m_allocated;
+    mutable long long m_reused;
+    mutable long long m_overflow;
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,154 @@
+#include "HeadlessRunner.h"
+#include "CompositeKernels.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTextStream>
+
+static QTextStream &out() { static QTextStream s(stdout); return s; }
+static QTextStream &err() { static QTextStream s(stderr); return s; }
+
+// ================= HeadlessJob Implementation =================
+HeadlessJob HeadlessJob::fromJson(const QJsonObject &o) {
+    HeadlessJob j;
+    j.input = o.value("input").toString(); j.output = o.value("output").toString();
+    j.startFrame = o.value("startFrame").toInt(j.startFrame); j.endFrame = o.value("endFrame").toInt(j.endFrame);
+    j.cropMode = o.value("cropMode").toInt(j.cropMode);
+    QJsonArray r = o.value("cropRect").toArray(); if (r.size() == 4) j.cropRect = QRect(r[0].toInt(), r[1].toInt(), r[2].toInt(), r[3].toInt());
+    j.trailLength = o.value("trailLength").toInt(j.trailLength); j.fade = o.value("fade").toDouble(j.fade);
+    j.targetHeight = o.value("targetHeight").toInt(j.targetHeight); j.fps = o.value("fps").toDouble(j.fps);
+    j.format = o.value("format").toString(j.format); if (!j.format.startsWith('.')) j.format.prepend('.');
+    j.exportVideo = o.value("exportVideo").toBool(j.exportVideo); j.exportLivePhoto = o.value("livePhoto").toBool(j.exportLivePhoto);
+    j.coverFrame = o.value("coverFrame").toInt(j.coverFrame); j.useOpenCL = o.value("openCL").toBool(j.useOpenCL);
+    j.readAhead = o.value("readAhead").toInt(j.readAhead); j.decodeThreads = o.value("decodeThreads").toInt(j.decodeThreads); j.writerQueue = o.value("writerQueue").toInt(j.writerQueue); j.compositeThreads = o.value("compositeThreads").toInt(j.compositeThreads); j.segments = o.value("segments").toInt(j.segments); j.checkpointInterval = o.value("checkpointInterval").toInt(j.checkpointInterval); j.trace = o.value("trace").toString(); j.nativeDepth = o.value("nativeDepth").toBool(j.nativeDepth); j.fullResComposite = o.value("fullResComposite").toBool(j.fullResComposite); j.historyTolerance = o.value("historyTolerance").toInt(j.historyTolerance);
+    EncoderSettings &e = j.encoder; e.backend = EncoderSettings::backendFromString(o.value("encoder").toString("opencv")); e.ffmpegPath = o.value("ffmpeg").toString();
+    e.codec = o.value("codec").toString(e.codec); e.preset = o.value("preset").toString(e.preset); e.crf = o.value("crf").toInt(e.crf); e.bitrateKbps = o.value("bitrate").toInt(e.bitrateKbps); e.threads = o.value("encoderThreads").toInt(e.threads); e.pixFmt = o.value("pixFmt").toString(e.pixFmt);
+    for (const QJsonValue &v : o.value("outputs").toArray()) {
+        QJsonObject t = v.toObject(); OutputTarget out;
+        out.path = t.value("output").toString(); out.tag = t.value("tag").toString(QString::number(j.outputs.size() + 1));
+        out.format = t.value("format").toString(j.format); if (!out.format.startsWith('.')) out.format.prepend('.');
+        out.height = t.value("targetHeight").toInt(out.height); out.fps = t.value("fps").toDouble(out.fps);
+        out.startFrame = t.value("startFrame").toInt(out.startFrame); out.endFrame = t.value("endFrame").toInt(out.endFrame); out.livePhoto = t.value("livePhoto").toBool(out.livePhoto);
+        out.encoder = e; out.encoder.crf = t.value("crf").toInt(e.crf); out.encoder.bitrateKbps = t.value("bitrate").toInt(e.bitrateKbps);
+        j.outputs << out;
+    }
+    return j;
+}
+
+// ================= HeadlessRunner Implementation =================
+int HeadlessRunner::run(const QStringList &args) {
+    QList<HeadlessJob> jobs;
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i].startsWith("--")) continue;
+        QFile f(args[i]);
+        if (!f.open(QIODevice::ReadOnly)) { err() << "无法读取任务文件: " << args[i] << Qt::endl; return 2; }
+        QJsonParseError pe; QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &pe);
+        if (pe.error != QJsonParseError::NoError || !doc.isObject()) { err() << "任务文件格式错误: " << args[i] << " (" << pe.errorString() << ")" << Qt::endl; return 2; }
+        QJsonObject root = doc.object();
+        if (root.contains("jobs")) { for (const QJsonValue &v : root.value("jobs").toArray()) jobs.append(HeadlessJob::fromJson(v.toObject())); }
+        else jobs.append(HeadlessJob::fromJson(root));
+    }
+    if (jobs.isEmpty()) { err() << "用法: StarTrails --headless job.json [job2.json ...]" << Qt::endl; return 2; }
+
+    int failed = 0;
+    for (int i = 0; i < jobs.size(); ++i) if (!runJob(jobs[i], i + 1, jobs.size())) failed++;
+    out() << QString("完成 %1/%2 个任务").arg(jobs.size() - failed).arg(jobs.size()) << Qt::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+bool HeadlessRunner::buildParams(const HeadlessJob &job, ProcessParams &p, QString &error) {
+    QFileInfo fi(job.input);
+    if (job.input.isEmpty() || !fi.exists()) { error = "输入不存在: " + job.input; return false; }
+
+    // 输入可以是视频、序列目录或序列中的任意一张图片(取同目录同后缀文件)
+    FrameProvider probe; QString ext = fi.suffix().toLower();
+    p.isVideo = !fi.isDir() && (ext == "mp4" || ext == "mov" || ext == "avi" || ext == "mkv");
+    if (p.isVideo) { p.videoPath = job.input; if (!probe.openVideo(job.input)) { error = "无法打开视频"; return false; } }
+    else {
+        QString dir = fi.isDir() ? fi.absoluteFilePath() : fi.absolutePath();
+        QStringList filters = fi.isDir() ? QStringList{"*.jpg", "*.jpeg", "*.png", "*.tif", "*.tiff", "*.dng", "*.cr2", "*.nef", "*.arw"} : QStringList{"*." + fi.suffix().toLower()};
+        SequenceInfo seq; // 序列清单：重复渲染同一目录时不再列目录、不再解码首帧
+        if (!SequenceManifest::openDirectory(dir, filters, seq) || !probe.openSequence(seq)) { error = "无法打开图片序列"; return false; }
+        p.imageFiles = seq.files;
+    }
+
+    p.outPath = job.output;
+    if (p.outPath.isEmpty()) { QFileInfo src(probe.getSourcePath()); p.outPath = src.dir().filePath(src.completeBaseName() + "_StarTrail" + job.format); }
+    p.trailLength = std::max(1, job.trailLength); p.fadeStrength = job.fade; p.targetRes = job.targetHeight; p.isMov = (job.format == ".mov"); p.useOpenCL = job.useOpenCL;
+    p.startFrame = job.startFrame; p.endFrame = job.endFrame < 0 ? probe.totalFrames() : job.endFrame; p.targetFps = job.fps > 0 ? job.fps : probe.fps();
+    p.readAheadDepth = job.readAhead; p.decodeThreads = job.decodeThreads > 0 ? job.decodeThreads : std::max(1, QThread::idealThreadCount() / 2); p.writerQueueCapacity = std::max(1, job.writerQueue); p.compositeThreads = job.compositeThreads; p.segments = job.segments > 0 ? job.segments : std::max(1, QThread::idealThreadCount() / 2); p.checkpointInterval = std::max(0, job.checkpointInterval); p.tracePath = job.trace; p.nativeDepth = job.nativeDepth; p.fullResComposite = job.fullResComposite; p.encoder = job.encoder; p.historyTolerance = job.historyTolerance; p.emitPreview = false;
+    p.extraOutputs = job.outputs; for (OutputTarget &t : p.extraOutputs) t.path = t.resolvedPath(p.outPath);
+    if (job.exportLivePhoto) { if (job.coverFrame < 0) p.coverCandidates = 1; else p.coverFrame = job.coverFrame; } // 只保留需要的封面帧
+    if (!job.cropRect.isEmpty()) {
+        QRect r = job.cropRect.intersected(QRect(0, 0, probe.width(), probe.height()));
+        if (r.isEmpty()) { error = "裁剪区域超出画面"; return false; }
+        p.finalCropRect = cv::Rect(r.x(), r.y(), r.width(), r.height());
+    } else p.finalCropRect = calculateRatioCrop(probe.width(), probe.height(), job.cropMode);
+    return true;
+}
+
+bool HeadlessRunner::runJob(const HeadlessJob &job, int jobIndex, int jobCount) {
+    QString tag = QString("[%1/%2]").arg(jobIndex).arg(jobCount);
+    ProcessParams p; QString error;
+    if (!buildParams(job, p, error)) { err() << tag << " 失败: " << error << Qt::endl; return false; }
+    out() << tag << " " << job.input << " -> " << p.outPath << Qt::endl;
+
+    ProcessorThread proc; proc.setParams(p);
+    QEventLoop loop; bool ok = false; int frames = 0; double lastFps = 0;
+    QElapsedTimer timer, printTimer; timer.start(); printTimer.start();
+    QObject::connect(&proc, &ProcessorThread::progressUpdated, &loop, [&](int c, int t, double fps) {
+        frames = c; lastFps = fps; if (c < t && printTimer.elapsed() < 1000) return; printTimer.restart();
+        out() << tag << QString(" %1/%2 帧  %3 FPS").arg(c).arg(t).arg(fps, 0, 'f', 1) << Qt::endl;
+    });
+    QObject::connect(&proc, &ProcessorThread::errorOccurred, &loop, [&](QString m) { error = m; loop.quit(); });
+    QObject::connect(&proc, &ProcessorThread::finished, &loop, [&](QString) { ok = true; loop.quit(); });
+    proc.start(); loop.exec(); proc.wait();
+
+    double secs = timer.elapsed() / 1000.0;
+    QFileInfo outInfo(p.outPath);
+    if (ok && (!outInfo.exists() || outInfo.size() == 0)) { ok = false; error = "编码器未写出文件"; }
+    if (!ok) { err() << tag << " 失败: " << error << Qt::endl; return false; }
+    out() << tag << QString(" 渲染完成: %1 帧, %2 s, 平均 %3 FPS, 合成线程 %4").arg(frames).arg(secs, 0, 'f', 2).arg(secs > 0 ? frames / secs : lastFps, 0, 'f', 2).arg(CompositeKernels::effectiveThreads(p.compositeThreads)) << Qt::endl;
+    RenderStats stats = proc.renderStats();
+    out() << tag << " 阶段耗时: " << stats.summary() << Qt::endl;
+    if (!stats.resourceSummary().isEmpty()) out() << tag << " 资源: " << stats.resourceSummary() << Qt::endl;
+    if (proc.historyPeakBytes() > 0) out() << tag << QString(" 拖尾历史峰值: %1 MB%2").arg(proc.historyPeakBytes() / 1048576.0, 0, 'f', 1).arg(p.historyTolerance >= 0 ? QString(" (压缩，误差 ≤ %1)").arg(p.historyTolerance) : QString()) << Qt::endl;
+    if (!p.tracePath.isEmpty()) out() << tag << " trace: " << p.tracePath << Qt::endl;
+    for (const OutputTarget &t : p.extraOutputs) {
+        QFileInfo fi(t.path); if (!fi.exists() || fi.size() == 0) { err() << tag << " 失败: 附加输出未写出 " << t.path << Qt::endl; return false; }
+        if (!t.livePhoto) out() << tag << " 附加输出: " << t.path << Qt::endl;
+    }
+
+    if (job.exportLivePhoto && !writeLivePhoto(job, p.outPath, proc.livePhotoVideo(), proc.coverCandidates())) { err() << tag << " 失败: 动态照片合成失败" << Qt::endl; return false; }
+    return true;
+}
+
+// 与 MainWindow::onProcessingFinished 相同的流程，封面帧由任务指定
+// 优先使用渲染时保留的无损候选帧，找不到时才重新解码输出视频
+bool HeadlessRunner::writeLivePhoto(const HeadlessJob &job, const QString &mainPath, const QString &videoPath, const QList<CoverCandidate> &covers) {
+    cv::Mat cover;
+    for (const CoverCandidate &c : covers) if (job.coverFrame < 0 || c.frameIndex == job.coverFrame) cover = c.image;
+    if (cover.empty()) {
+        VideoFrameReader reader(videoPath); if (!reader.isOpened()) return false;
+        int total = (int)reader.get(cv::CAP_PROP_FRAME_COUNT);
+        int idx = (job.coverFrame < 0 || job.coverFrame >= total) ? total - 1 : job.coverFrame;
+        VideoIndex::get(videoPath, true); // 刚写出的视频没有缓存索引，等扫描完成再精确定位
+        if (!reader.seek(idx) || !reader.read(cover)) return false;
+    }
+
+    QFileInfo vi(mainPath);
+    QString finalJpgPath = vi.dir().filePath(vi.completeBaseName() + ".jpg");
+    QString tempJpg = finalJpgPath + ".tmp.jpg";
+    cv::imwrite(tempJpg.toStdString(), cover);
+    bool ok = MotionPhotoMuxer::mux(tempJpg, videoPath, finalJpgPath);
+    QFile::remove(tempJpg);
+    if (ok && videoPath != mainPath) QFile::remove(videoPath); // 实况短片已内嵌
+    if (ok && !job.exportVideo) QFile::remove(mainPath);
+    if (ok) out() << "动态照片: " << finalJpgPath << Qt::endl;
+    return ok;
+}
@@ -0,0 +1,57 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+#include "MainWindow.h"
+
+// --- 命令行渲染任务 ---
+// 用法: StarTrails --headless job.json [job2.json ...]
+// 任务文件为单个 JSON 对象，或 {"jobs": [ ... ]} 形式的任务队列，字段见 Readme。
+struct HeadlessJob {
+    QString input;
+    QString output;
+    int startFrame = 0;
+    int endFrame = -1;          // -1 = 到结尾
+    int cropMode = 0;           // 同 RenderConfigDialog 画幅：0 原始, 1 16:9, 2 9:16, 3 1:1, 4 4:5, 5 2.35
+    QRect cropRect;             // 非空时优先于 cropMode
+    int trailLength = 120;
+    double fade = 0.85;
+    int targetHeight = 1080;    // 0 = 原始分辨率
+    double fps = 0;             // 0 = 源帧率
+    QString format = ".mp4";
+    bool exportVideo = true;
+    bool exportLivePhoto = false;
+    int coverFrame = -1;        // 实况封面帧，-1 = 最后一帧
+    bool useOpenCL = false;
+    int readAhead = 8;
+    int decodeThreads = 0;      // 0 = 自动
+    int writerQueue = 15;       // 编码队列容量(帧)
+    int compositeThreads = 0;   // 分块合成线程数，0 = 全部核心
+    int segments = 1;           // 分段并行渲染段数，0 = 按核心数自动，1 = 串行
+    int checkpointInterval = 0; // 检查点间隔(输出帧)，0 = 关闭
+    QString trace;              // 非空时导出 Chrome trace JSON
+    bool nativeDepth = true;    // 16 位序列按 16 位合成
+    bool fullResComposite = true; // 降分辨率导出时仍按原尺寸合成；false = 先缩放再合成(更快，输出与旧版不同)
+    int historyTolerance = -1;  // 拖尾历史压缩误差上限(8 位灰阶)，-1 = 不压缩
+    EncoderSettings encoder;    // encoder/codec/preset/crf/bitrate/encoderThreads/pixFmt
+    QList<OutputTarget> outputs; // 附加输出，编码设置继承自任务，可单独覆盖 crf/bitrate
+
+    static HeadlessJob fromJson(const QJsonObject &o);
+};
+
+class HeadlessRunner {
+public:
+    // 返回进程退出码：0 全部成功，1 有任务失败，2 参数错误
+    static int run(const QStringList &args);
+
+private:
+    static bool runJob(const HeadlessJob &job, int jobIndex, int jobCount);
+    static bool buildParams(const HeadlessJob &job, ProcessParams &p, QString &error);
+    // videoPath 为内嵌的视频(主输出或实况短片)，实况照片按主输出 mainPath 命名
+    static bool writeLivePhoto(const HeadlessJob &job, const QString &mainPath, const QString &videoPath, const QList<CoverCandidate> &covers);
+};
+
+#endif // HEADLESSRUNNER_H
@@ -1,4 +1,9 @@
-#include "mainwindow.h"
+#include "MainWindow.h"
+#include "TrailEngine.h"
+#include "FramePool.h"
+#include "ProxyCache.h"
+#include "OclTrailPipeline.h"
+#include "RenderCheckpoint.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFrame>
@@ -15,8 +20,55 @@
 #include <QByteArray>
 #include <QTimer>
 #include <QDataStream>
+#include <QScopedPointer>
+#include <QHash>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QJsonObject>
+#include <QJsonArray>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#endif
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
 
 // ================= MotionPhotoMuxer (动态照片生成器) =================
+// 从 src 的 offset 处复制 len 字节到 dst 当前位置。
+// Linux 下优先走内核拷贝(copy_file_range/sendfile)，否则按固定大小分块读写，内存占用与文件大小无关。
+static bool copyFileRange(QFile &src, qint64 offset, qint64 len, QFile &dst) {
+    if (len <= 0) return true;
+#ifdef Q_OS_LINUX
+    if (dst.flush()) {
+        int in = src.handle(), outFd = dst.handle(); off_t off = offset; qint64 left = len;
+        while (left > 0) {
+            ssize_t n = ::copy_file_range(in, &off, outFd, nullptr, (size_t)std::min<qint64>(left, 1 << 30), 0);
+            if (n <= 0) n = ::sendfile(outFd, in, &off, (size_t)std::min<qint64>(left, 1 << 30));
+            if (n <= 0) break;
+            left -= n;
+        }
+        if (left == 0) return true;
+        // 内核拷贝中途失败(如跨文件系统不支持)，剩余部分走用户态
+        offset += len - left; len = left;
+        if (!dst.seek(dst.size())) return false;
+    }
+#endif
+    if (!src.seek(offset)) return false;
+    QByteArray chunk(1 << 20, Qt::Uninitialized);
+    while (len > 0) {
+        qint64 n = src.read(chunk.data(), std::min<qint64>(len, chunk.size()));
+        if (n <= 0 || dst.write(chunk.constData(), n) != n) return false;
+        len -= n;
+    }
+    return true;
+}
+
 // 核心逻辑：构造符合 Google Photos 标准的 XMP Metadata 并插入 JPEG
 bool MotionPhotoMuxer::mux(const QString &jpgPath, const QString &mp4Path, const QString &outPath) {
     QFile fJpg(jpgPath);
@@ -24,12 +76,8 @@ bool MotionPhotoMuxer::mux(const QString &jpgPath, const QString &mp4Path, const
 
     if (!fJpg.open(QIODevice::ReadOnly) || !fMp4.open(QIODevice::ReadOnly)) return false;
 
-    QByteArray jpgData = fJpg.readAll();
-    QByteArray mp4Data = fMp4.readAll();
-    fJpg.close();
-    fMp4.close();
-
-    if (jpgData.size() < 2 || (unsigned char)jpgData[0] != 0xFF || (unsigned char)jpgData[1] != 0xD8) {
+    QByteArray soi = fJpg.read(2);
+    if (soi.size() < 2 || (unsigned char)soi[0] != 0xFF || (unsigned char)soi[1] != 0xD8) {
         qDebug() << "Not a valid JPEG";
         return false;
     }
@@ -37,7 +85,7 @@ bool MotionPhotoMuxer::mux(const QString &jpgPath, const QString &mp4Path, const
     // 1. 构造 XMP 数据包
     // 使用 Google MicroVideo V1 标准，这是最兼容的格式
     // 关键是 GCamera:MicroVideoOffset = 视频文件字节数
-    long long videoSize = mp4Data.size();
+    long long videoSize = fMp4.size();
     QString xmpContent =
         "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\" x:xmptk=\"Adobe XMP Core 5.1.0-jc003\">"
         "  <rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">"
@@ -67,44 +115,49 @@ bool MotionPhotoMuxer::mux(const QString &jpgPath, const QString &mp4Path, const
     app1.append(namespaceUri);
     app1.append(xmpContent.toUtf8());
 
-    // 3. 插入 APP1 到 JPEG (通常插在 SOI (FF D8) 之后)
-    // 简单的插入逻辑：在 index 2 处插入
-    QByteArray finalData = jpgData;
-    finalData.insert(2, app1);
-
-    // 4. 追加 MP4 数据到文件末尾
-    finalData.append(mp4Data);
-
-    // 5. 写入输出文件
+    // 3. 流式写出: SOI + APP1 + JPEG 剩余部分 + MP4，不在内存中拼接整个文件
     QFile fOut(outPath);
-    if (!fOut.open(QIODevice::WriteOnly)) return false;
-    fOut.write(finalData);
+    if (!fOut.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) return false;
+    bool ok = fOut.write(soi) == soi.size() && fOut.write(app1) == app1.size()
+              && copyFileRange(fJpg, 2, fJpg.size() - 2, fOut)
+              && copyFileRange(fMp4, 0, videoSize, fOut);
     fOut.close();
-
+    if (!ok) { qDebug() << "Motion photo write failed:" << outPath; QFile::remove(outPath); return false; }
     return true;
 }
 
 // ================= 辅助函数 =================
 
+// 同一目录下同类型的 RAW 来自同一相机，页布局相同：记住选中的页，后续文件跳过解析
+static QMutex g_tiffPageMutex;
+static QHash<QString, int> g_tiffPageCache;
+
+void rememberTiffPage(const QString &path, int page) {
+    if (page < 0) return;
+    QFileInfo info(path); QMutexLocker l(&g_tiffPageMutex); g_tiffPageCache.insert(info.absolutePath() + "|" + info.suffix().toLower(), page);
+}
+
 cv::Mat customImread(const QString &path) {
     cv::Mat img;
     std::string sPath = path.toLocal8Bit().constData();
-    QString ext = QFileInfo(path).suffix().toLower();
+    QFileInfo info(path); QString ext = info.suffix().toLower();
 
     if (ext == "dng" || ext == "tif" || ext == "tiff" || ext == "cr2" || ext == "nef" || ext == "arw") {
-        std::vector<cv::Mat> pages;
-        try {
-            cv::imreadmulti(sPath, pages, cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH);
-        } catch (...) { qDebug() << "imreadmulti failed for" << path; }
-
-        if (!pages.empty()) {
-            size_t maxIdx = 0; int maxPixels = 0;
-            for (size_t i = 0; i < pages.size(); ++i) {
-                if (pages[i].empty()) continue;
-                int p = pages[i].cols * pages[i].rows;
-                if (p > maxPixels) { maxPixels = p; maxIdx = i; }
-            }
-            if (maxPixels > 0) img = pages[maxIdx];
+        QString layoutKey = info.absolutePath() + "|" + ext;
+        int page; { QMutexLocker l(&g_tiffPageMutex); page = g_tiffPageCache.value(layoutKey, -1); }
+        bool cached = page >= 0;
+        for (int attempt = 0; attempt < 2 && img.empty(); ++attempt) {
+            if (!cached || attempt > 0) { page = SequenceManifest::largestTiffPage(path); cached = false; }
+            if (page < 0) break;
+            std::vector<cv::Mat> pages;
+            try { cv::imreadmulti(sPath, pages, page, 1, cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH); } catch (...) { qDebug() << "imreadmulti failed for" << path << "page" << page; }
+            if (!pages.empty() && !pages[0].empty()) { img = pages[0]; QMutexLocker l(&g_tiffPageMutex); g_tiffPageCache.insert(layoutKey, page); }
+            if (!cached) break; // 缓存的页失效时重新解析一次
+        }
+        if (img.empty()) { // 无法解析的容器，或选中的页解码失败：退回逐页解码取最大页
+            std::vector<cv::Mat> pages;
+            try { cv::imreadmulti(sPath, pages, cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH); } catch (...) { qDebug() << "imreadmulti failed for" << path; }
+            for (const cv::Mat &p : pages) if (!p.empty() && (img.empty() || p.total() > img.total())) img = p;
         }
     }
 
@@ -161,21 +214,61 @@ cv::Rect calculateRatioCrop(int w, int h, int mode) {
     return cv::Rect((w - newW) / 2, (h - newH) / 2, newW, newH);
 }
 
+// ================= SequencePrefetcher Implementation =================
+SequencePrefetcher::SequencePrefetcher(const QStringList &files, int w, int h, int depth, int workers, bool nativeDepth, RenderTrace *trace)
+    : m_files(files), m_w(w), m_h(h), m_depth(std::max(1, depth)), m_nativeDepth(nativeDepth), m_trace(trace), m_nextDecode(0), m_consumeIndex(0), m_generation(0), m_stopping(false)
+{
+    for (int i = 0; i < std::max(1, workers); ++i) { QThread *t = QThread::create([this]() { workerLoop(); }); m_workers.append(t); t->start(); }
+}
+SequencePrefetcher::~SequencePrefetcher() {
+    { QMutexLocker l(&m_mutex); m_stopping = true; m_workCond.wakeAll(); m_readyCond.wakeAll(); }
+    for (QThread *t : m_workers) { t->wait(); delete t; }
+}
+void SequencePrefetcher::workerLoop() {
+    if (m_trace) m_trace->nameThread("decode");
+    while (true) {
+        int idx, gen;
+        {
+            QMutexLocker l(&m_mutex);
+            while (!m_stopping && (m_nextDecode >= m_files.size() || m_nextDecode >= m_consumeIndex + m_depth)) m_workCond.wait(&m_mutex);
+            if (m_stopping) return;
+            idx = m_nextDecode++; gen = m_generation;
+        }
+        cv::Mat img; { StageScope t(m_trace, RenderStage::Decode); FrameProvider::decodeSequenceFrame(m_files[idx], m_w, m_h, img, m_nativeDepth); }
+        QMutexLocker l(&m_mutex);
+        if (gen == m_generation) { m_ready.insert(idx, img); m_readyCond.wakeAll(); }
+    }
+}
+bool SequencePrefetcher::take(int index, cv::Mat &image) {
+    if (index < 0 || index >= m_files.size()) return false;
+    QMutexLocker l(&m_mutex);
+    if (index != m_consumeIndex) { m_generation++; m_ready.clear(); m_nextDecode = index; m_consumeIndex = index; m_workCond.wakeAll(); }
+    while (!m_stopping && !m_ready.contains(index)) m_readyCond.wait(&m_mutex);
+    if (m_stopping) return false;
+    image = m_ready.take(index); m_consumeIndex = index + 1; m_workCond.wakeAll();
+    return !image.empty();
+}
+
 // ================= FrameProvider Implementation =================
-FrameProvider::FrameProvider() : m_isVideo(false), m_cap(nullptr), m_currentIndex(0), m_total(0), m_w(0), m_h(0), m_fps(30.0) {}
+FrameProvider::FrameProvider() : m_isVideo(false), m_video(nullptr), m_currentIndex(0), m_total(0), m_w(0), m_h(0), m_fps(30.0), m_readAheadDepth(0), m_decodeWorkers(0), m_nativeDepth(false), m_trace(nullptr), m_prefetcher(nullptr) {}
 FrameProvider::~FrameProvider() { close(); }
-void FrameProvider::close() { if (m_cap) { delete m_cap; m_cap = nullptr; } m_files.clear(); m_total = 0; }
+void FrameProvider::close() { if (m_video) { delete m_video; m_video = nullptr; } if (m_prefetcher) { delete m_prefetcher; m_prefetcher = nullptr; } m_files.clear(); m_total = 0; }
 bool FrameProvider::openVideo(const QString &path) {
-    close(); m_isVideo = true; m_mainPath = path; m_cap = new cv::VideoCapture(path.toStdString());
-    if (m_cap->isOpened()) {
-        m_total = (int)m_cap->get(cv::CAP_PROP_FRAME_COUNT); m_w = (int)m_cap->get(cv::CAP_PROP_FRAME_WIDTH); m_h = (int)m_cap->get(cv::CAP_PROP_FRAME_HEIGHT);
-        m_fps = m_cap->get(cv::CAP_PROP_FPS); if(m_fps <= 0) m_fps = 25.0; return true;
+    close(); m_isVideo = true; m_mainPath = path; m_video = new VideoFrameReader(path);
+    if (m_video->isOpened()) {
+        m_total = (int)m_video->get(cv::CAP_PROP_FRAME_COUNT); m_w = (int)m_video->get(cv::CAP_PROP_FRAME_WIDTH); m_h = (int)m_video->get(cv::CAP_PROP_FRAME_HEIGHT);
+        m_fps = m_video->get(cv::CAP_PROP_FPS); if(m_fps <= 0) m_fps = 25.0; return true;
     } return false;
 }
 bool FrameProvider::openSequence(const QStringList &files) {
-    close(); if(files.isEmpty()) return false; m_isVideo = false; m_files = files; m_files.sort();
-    m_mainPath = files.first(); m_total = files.size(); m_currentIndex = 0; m_fps = 25.0;
-    cv::Mat tmp = customImread(m_mainPath); if (!tmp.empty()) { m_w = tmp.cols; m_h = tmp.rows; return true; } return false;
+    SequenceInfo info; return SequenceManifest::openFiles(files, info) && openSequence(info);
+}
+bool FrameProvider::openSequence(const SequenceInfo &info) {
+    close(); if(info.files.isEmpty()) return false; m_isVideo = false; m_files = info.files;
+    m_mainPath = m_files.first(); m_total = m_files.size(); m_currentIndex = 0; m_fps = 25.0;
+    rememberTiffPage(m_mainPath, info.tiffPage);
+    if (info.width > 0 && info.height > 0) { m_w = info.width; m_h = info.height; return true; }
+    cv::Mat tmp = customImread(m_mainPath); if (!tmp.empty()) { m_w = tmp.cols; m_h = tmp.rows; return true; } return false; // 文件头无法解析的格式
 }
 bool FrameProvider::isOpened() const { return m_total > 0; }
 int FrameProvider::totalFrames() const { return m_total; }
@@ -183,20 +276,37 @@ double FrameProvider::fps() const { return m_fps; }
 int FrameProvider::width() const { return m_w; }
 int FrameProvider::height() const { return m_h; }
 QString FrameProvider::getSourcePath() const { return m_mainPath; }
+void FrameProvider::setReadAhead(int depth, int workers) {
+    m_readAheadDepth = std::max(0, depth); m_decodeWorkers = std::max(0, workers);
+    if (m_prefetcher) { delete m_prefetcher; m_prefetcher = nullptr; }
+}
+void FrameProvider::setNativeDepth(bool on) {
+    m_nativeDepth = on;
+    if (m_prefetcher) { delete m_prefetcher; m_prefetcher = nullptr; }
+}
+// 解码单个序列文件：16 位降为 8 位 BGR(nativeDepth 时保持 16 位)，尺寸与首帧不一致时缩放
+bool FrameProvider::decodeSequenceFrame(const QString &path, int w, int h, cv::Mat &image, bool nativeDepth) {
+    image = customImread(path);
+    bool gray16 = !image.empty() && image.type() == CV_16UC1;
+    if (!nativeDepth && (gray16 || (!image.empty() && image.type() == CV_16UC3))) image.convertTo(image, CV_8U, 255.0/65535.0);
+    if (gray16) cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+    if (!image.empty() && (image.cols != w || image.rows != h)) cv::resize(image, image, cv::Size(w, h));
+    return !image.empty();
+}
 bool FrameProvider::read(cv::Mat &image) {
-    if (m_isVideo) { if (!m_cap) return false; return m_cap->read(image); }
+    if (m_isVideo) { if (!m_video) return false; StageScope t(m_trace, RenderStage::Decode); return m_video->read(image); }
     else {
         if (m_currentIndex >= m_files.size()) return false;
-        image = customImread(m_files[m_currentIndex]);
-        if (!image.empty() && image.type() == CV_16UC3) image.convertTo(image, CV_8UC3, 255.0/65535.0);
-        else if (!image.empty() && image.type() == CV_16UC1) { cv::Mat t; image.convertTo(t, CV_8UC1, 255.0/65535.0); cv::cvtColor(t, image, cv::COLOR_GRAY2BGR); }
-        if (!image.empty() && (image.cols != m_w || image.rows != m_h)) cv::resize(image, image, cv::Size(m_w, m_h));
-        m_currentIndex++; return !image.empty();
+        if (m_readAheadDepth > 0 && m_decodeWorkers > 0) {
+            if (!m_prefetcher) m_prefetcher = new SequencePrefetcher(m_files, m_w, m_h, m_readAheadDepth, m_decodeWorkers, m_nativeDepth, m_trace);
+            bool ok = m_prefetcher->take(m_currentIndex, image); m_currentIndex++; return ok;
+        }
+        StageScope t(m_trace, RenderStage::Decode); bool ok = decodeSequenceFrame(m_files[m_currentIndex], m_w, m_h, image, m_nativeDepth); m_currentIndex++; return ok;
     }
 }
 bool FrameProvider::seek(int frameIndex) {
     if (frameIndex < 0 || frameIndex >= m_total) return false;
-    if (m_isVideo) return m_cap->set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+    if (m_isVideo) return m_video && m_video->seek(frameIndex);
     else { m_currentIndex = frameIndex; return true; }
 }
 
@@ -266,7 +376,7 @@ void CropEditorDialog::paintEvent(QPaintEvent *) {
 
 // ================= RenderConfigDialog Implementation =================
 RenderConfigDialog::RenderConfigDialog(FrameProvider *provider, QWidget *parent)
-    : QDialog(parent), m_provider(provider)
+    : QDialog(parent), m_provider(provider), m_proxy(nullptr)
 {
     setWindowTitle("导出与裁剪设置"); resize(650, 750);
     QVBoxLayout *lay = new QVBoxLayout(this);
@@ -291,20 +401,45 @@ RenderConfigDialog::RenderConfigDialog(FrameProvider *provider, QWidget *parent)
     QHBoxLayout *hFps = new QHBoxLayout; hFps->addWidget(new QLabel("输出帧率(FPS):"));
     m_spinFps = new QDoubleSpinBox; m_spinFps->setRange(1.0, 120.0); m_spinFps->setSingleStep(1.0); m_spinFps->setValue(m_provider->fps());
     connect(m_spinFps, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &RenderConfigDialog::updateDurationLabel);
-    hFps->addWidget(m_spinFps); lRes->addLayout(hFps); lay->addWidget(grpRes);
+    hFps->addWidget(m_spinFps); lRes->addLayout(hFps);
+    m_chkFullRes = new QCheckBox("全分辨率合成 (取消勾选后降分辨率导出时先缩放再合成，更快但细星轨可能变淡)"); m_chkFullRes->setChecked(true); lRes->addWidget(m_chkFullRes);
+    m_chkCompressHistory = new QCheckBox("压缩拖尾历史 (长拖尾/高分辨率省内存，误差不超过 2 灰阶)"); m_chkCompressHistory->setChecked(false); lRes->addWidget(m_chkCompressHistory); lay->addWidget(grpRes);
 
     updateDurationLabel();
 
-    QGroupBox *grpMode = new QGroupBox("3. 导出"); QVBoxLayout *lMode = new QVBoxLayout(grpMode); m_rbVideoOnly = new QRadioButton("仅视频"); m_rbVideoOnly->setChecked(true); m_rbLivePhoto = new QRadioButton("仅实况"); m_rbBoth = new QRadioButton("全部"); lMode->addWidget(m_rbVideoOnly); lMode->addWidget(m_rbLivePhoto); lMode->addWidget(m_rbBoth); lay->addWidget(grpMode);
-    QHBoxLayout *hFmt = new QHBoxLayout; m_cmbFormat = new QComboBox; m_cmbFormat->addItem("MP4", ".mp4"); m_cmbFormat->addItem("MOV", ".mov"); hFmt->addWidget(new QLabel("格式:")); hFmt->addWidget(m_cmbFormat); lay->addLayout(hFmt); m_chkOpenCL = new QCheckBox("GPU加速"); m_chkOpenCL->setChecked(true); lay->addWidget(m_chkOpenCL);
+    QGroupBox *grpMode = new QGroupBox("3. 导出"); QVBoxLayout *lMode = new QVBoxLayout(grpMode); m_rbVideoOnly = new QRadioButton("仅视频"); m_rbVideoOnly->setChecked(true); m_rbLivePhoto = new QRadioButton("仅实况"); m_rbBoth = new QRadioButton("全部"); lMode->addWidget(m_rbVideoOnly); lMode->addWidget(m_rbLivePhoto); lMode->addWidget(m_rbBoth);
+    // 附加输出与主输出共用同一次解码合成，每个输出一个编码线程
+    m_chkSocialCut = new QCheckBox("同时导出 1080p 版本"); lMode->addWidget(m_chkSocialCut);
+    m_chkLiveClip = new QCheckBox("实况照片只内嵌最后 3 秒 (720p)"); m_chkLiveClip->setEnabled(false); lMode->addWidget(m_chkLiveClip);
+    connect(m_rbVideoOnly, &QRadioButton::toggled, m_chkLiveClip, &QWidget::setDisabled); lay->addWidget(grpMode);
+    QHBoxLayout *hFmt = new QHBoxLayout; m_cmbFormat = new QComboBox; m_cmbFormat->addItem("MP4", ".mp4"); m_cmbFormat->addItem("MOV", ".mov"); hFmt->addWidget(new QLabel("格式:")); hFmt->addWidget(m_cmbFormat);
+    m_cmbEncoder = new QComboBox; m_cmbEncoder->addItem("OpenCV", false); m_cmbEncoder->addItem("FFmpeg (x264 管道)", true); hFmt->addWidget(new QLabel("编码器:")); hFmt->addWidget(m_cmbEncoder); lay->addLayout(hFmt);
+    if (QStandardPaths::findExecutable("ffmpeg").isEmpty()) { m_cmbEncoder->setItemData(1, 0, Qt::UserRole - 1); m_cmbEncoder->setToolTip("未找到 ffmpeg"); }
+    m_chkOpenCL = new QCheckBox("GPU加速"); m_chkOpenCL->setChecked(true); lay->addWidget(m_chkOpenCL);
     lay->addStretch();
     QHBoxLayout *hBtn = new QHBoxLayout; QPushButton *btnC = new QPushButton("取消"); QPushButton *btnOk = new QPushButton("开始"); btnOk->setStyleSheet("background-color: #00A8E8; color: black; font-weight: bold;"); connect(btnC, &QPushButton::clicked, this, &QDialog::reject); connect(btnOk, &QPushButton::clicked, this, &QDialog::accept); hBtn->addStretch(); hBtn->addWidget(btnC); hBtn->addWidget(btnOk); lay->addLayout(hBtn);
 
-    QTimer *debounceTimer = new QTimer(this); debounceTimer->setObjectName("previewTimer"); debounceTimer->setSingleShot(true); debounceTimer->setInterval(150);
-    connect(debounceTimer, &QTimer::timeout, this, [this](){ int value = m_sliderTimeline->value(); m_provider->seek(value); cv::Mat f; if (m_provider->read(f)) { int w = m_lblVideoPreview->width(); int h = m_lblVideoPreview->height(); if(w<=0)w=400; if(h<=0)h=240; cv::resize(f, f, cv::Size(w, h)); QImage img = matToQImage(f); m_lblVideoPreview->setPixmap(QPixmap::fromImage(img)); } });
+    // 时间轴预览走代理缓存，只有裁剪编辑器才做全尺寸解码
+    m_proxy = new ProxyCache(m_provider->getSourcePath(), m_provider->isVideo() ? QStringList() : m_provider->files(), m_provider->totalFrames(), m_provider->width(), m_provider->height(), 240, this);
+    connect(m_proxy, &ProxyCache::proxyReady, this, &RenderConfigDialog::onProxyReady);
+    m_proxy->start();
+
+    QTimer *debounceTimer = new QTimer(this); debounceTimer->setObjectName("previewTimer"); debounceTimer->setSingleShot(true); debounceTimer->setInterval(30);
+    connect(debounceTimer, &QTimer::timeout, this, [this](){ showTimelinePreview(m_sliderTimeline->value()); });
     onTimelineChanged(0);
 }
 RenderConfigDialog::~RenderConfigDialog() {}
+void RenderConfigDialog::showTimelinePreview(int index) {
+    QImage img; bool exact = false;
+    if (!m_proxy->thumbnail(index, img, &exact)) { m_proxy->request(index); m_lblVideoPreview->setText("生成预览中..."); return; }
+    if (!exact) m_proxy->request(index); // 先显示最近的代理帧，精确帧就绪后 onProxyReady 刷新
+    m_lblVideoPreview->setPixmap(QPixmap::fromImage(img).scaled(m_lblVideoPreview->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+}
+void RenderConfigDialog::onProxyReady(int index) {
+    int cur = m_sliderTimeline->value();
+    // 当前帧就绪，或预览仍为空(第一个代理帧到达)时刷新
+    if (index == cur || m_lblVideoPreview->pixmap().isNull()) showTimelinePreview(cur);
+}
 
 void RenderConfigDialog::onTimelineChanged(int value) { m_lblCurrentFrame->setText(QString("%1").arg(value)); QTimer *t = findChild<QTimer*>("previewTimer"); if(t) t->start(); }
 void RenderConfigDialog::onSetStartClicked() { m_spinStartFrame->setValue(m_sliderTimeline->value()); }
@@ -317,27 +452,122 @@ void RenderConfigDialog::updateDurationLabel() {
 void RenderConfigDialog::onCropModeChanged(int i) { if(m_cmbCropRatio->itemData(i).toInt()==99) { m_btnEditCrop->setVisible(true); if(m_currentManualRect.isEmpty()) openCropEditor(); } else m_btnEditCrop->setVisible(false); }
 void RenderConfigDialog::openCropEditor() { m_provider->seek(m_sliderTimeline->value()); cv::Mat f; m_provider->read(f); if(f.empty()) return; CropEditorDialog dlg(f, m_currentManualRect, this); if(dlg.exec()==QDialog::Accepted) { m_currentManualRect = dlg.getFinalCropRect(); m_btnEditCrop->setText(QString("区域: %1x%2").arg(m_currentManualRect.width()).arg(m_currentManualRect.height())); } }
 RenderSettings RenderConfigDialog::getSettings() {
-    RenderSettings s; s.targetHeight=m_cmbRes->currentData().toInt(); s.exportVideo=m_rbVideoOnly->isChecked()||m_rbBoth->isChecked(); s.exportLivePhoto=m_rbLivePhoto->isChecked()||m_rbBoth->isChecked(); s.useOpenCL=m_chkOpenCL->isChecked(); s.outputFormat=m_cmbFormat->currentData().toString(); s.startFrame=m_spinStartFrame->value(); s.endFrame=m_spinEndFrame->value(); s.cropRatioMode=m_cmbCropRatio->currentData().toInt(); s.manualCropRect=m_currentManualRect; s.targetFps = m_spinFps->value(); return s;
+    RenderSettings s; s.targetHeight=m_cmbRes->currentData().toInt(); s.exportVideo=m_rbVideoOnly->isChecked()||m_rbBoth->isChecked(); s.exportLivePhoto=m_rbLivePhoto->isChecked()||m_rbBoth->isChecked(); s.useOpenCL=m_chkOpenCL->isChecked(); s.outputFormat=m_cmbFormat->currentData().toString(); s.startFrame=m_spinStartFrame->value(); s.endFrame=m_spinEndFrame->value(); s.cropRatioMode=m_cmbCropRatio->currentData().toInt(); s.manualCropRect=m_currentManualRect; s.targetFps = m_spinFps->value(); s.fullResComposite = m_chkFullRes->isChecked(); s.ffmpegEncoder = m_cmbEncoder->currentData().toBool(); s.compressHistory = m_chkCompressHistory->isChecked();
+    if(m_chkSocialCut->isChecked()) { OutputTarget t; t.tag = "1080p"; t.height = 1080; t.format = s.outputFormat; s.extraOutputs << t; }
+    if(s.exportLivePhoto && m_chkLiveClip->isChecked()) { OutputTarget t; t.tag = "live"; t.height = 720; t.startFrame = -(int)std::lround(3 * s.targetFps); t.livePhoto = true; s.extraOutputs << t; }
+    return s;
 }
 
 // ================= VideoWriterWorker Implementation =================
-VideoWriterWorker::VideoWriterWorker(QString path, int w, int h, double fps, bool isMov)
-    : m_path(path), m_width(w), m_height(h), m_fps(fps), m_running(true) { if(m_width%2!=0)m_width--; if(m_height%2!=0)m_height--; }
-void VideoWriterWorker::addFrame(const cv::Mat &frame) { while (true) { m_mutex.lock(); if (m_queue.size() < 15) { m_queue.enqueue(frame.clone()); m_condition.wakeOne(); m_mutex.unlock(); break; } m_mutex.unlock(); QThread::msleep(30); } }
-void VideoWriterWorker::stop() { m_running=false; m_condition.wakeAll(); wait(); }
+VideoWriterWorker::VideoWriterWorker(QString path, int w, int h, double fps, bool isMov, int queueCapacity)
+    : m_path(path), m_width(w), m_height(h), m_fps(fps), m_isMov(isMov), m_fallback(true), m_capacity(std::max(1, queueCapacity)), m_running(true), m_pool(nullptr), m_trace(nullptr) { if(m_width%2!=0)m_width--; if(m_height%2!=0)m_height--; m_stats.capacity = m_capacity; }
+void VideoWriterWorker::addFrame(const cv::Mat &frame) {
+    StageScope t(m_trace, RenderStage::Enqueue);
+    if (m_pool) { cv::Mat slot = m_pool->acquire(frame.size(), frame.type()); frame.copyTo(slot); enqueue(slot); }
+    else enqueue(frame.clone());
+}
+void VideoWriterWorker::addSharedFrame(const cv::Mat &frame) { StageScope t(m_trace, RenderStage::Enqueue); enqueue(frame); }
+void VideoWriterWorker::enqueue(const cv::Mat &frame) {
+    QMutexLocker l(&m_mutex);
+    if (m_queue.size() >= m_capacity && m_running) {
+        QElapsedTimer t; t.start();
+        while (m_queue.size() >= m_capacity && m_running) m_notFull.wait(&m_mutex);
+        m_stats.producerStallMs += t.nsecsElapsed() / 1e6;
+    }
+    if (!m_running) return; // 已停止：丢弃，避免在无人消费的队列上永久阻塞
+    m_queue.enqueue(frame); m_stats.framesQueued++; m_stats.maxDepth = std::max(m_stats.maxDepth, (int)m_queue.size());
+    m_notEmpty.wakeOne();
+}
+void VideoWriterWorker::stop() { { QMutexLocker l(&m_mutex); m_running = false; } m_notEmpty.wakeAll(); m_notFull.wakeAll(); wait(); }
+WriterQueueStats VideoWriterWorker::stats() { QMutexLocker l(&m_mutex); return m_stats; }
 void VideoWriterWorker::run() {
-    int fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1'); cv::VideoWriter writer;
-    writer.open(m_path.toStdString(), fourcc, m_fps, cv::Size(m_width, m_height));
-    while(m_running || !m_queue.isEmpty()) { cv::Mat frame; { QMutexLocker l(&m_mutex); while(m_queue.isEmpty()&&m_running) m_condition.wait(&m_mutex); if(!m_queue.isEmpty()) frame=m_queue.dequeue(); } if(!frame.empty()) { if(frame.cols!=m_width || frame.rows!=m_height) cv::resize(frame, frame, cv::Size(m_width, m_height), 0, 0, cv::INTER_AREA); writer.write(frame); } } writer.release();
+    if (m_trace) m_trace->nameThread("encoder");
+    QScopedPointer<VideoEncoder> encoder(VideoEncoder::create(m_encoder)); cv::Size size(m_width, m_height);
+    bool ok = encoder->open(m_path, size, m_fps, m_isMov);
+    if (!ok && m_fallback && m_encoder.backend != EncoderSettings::OpenCV) {
+        qDebug() << encoder->lastError() << "，改用 OpenCV 编码";
+        encoder.reset(new OpenCvEncoder); ok = encoder->open(m_path, size, m_fps, m_isMov);
+    }
+    // 失败只记录第一个原因；编码器没打开时队列照常排空，生产者不会阻塞
+    auto fail = [&](const QString &why) { ok = false; QMutexLocker l(&m_mutex); if (m_stats.error.isEmpty()) m_stats.error = QString("%1 编码失败: %2").arg(encoder->name()).arg(why); };
+    bool opened = ok; if (!opened) fail(encoder->lastError());
+    cv::Mat scaled, quantized;
+    while (true) {
+        cv::Mat frame;
+        {
+            QMutexLocker l(&m_mutex);
+            if (m_queue.isEmpty() && m_running) {
+                QElapsedTimer t; t.start();
+                while (m_queue.isEmpty() && m_running) m_notEmpty.wait(&m_mutex);
+                m_stats.consumerIdleMs += t.nsecsElapsed() / 1e6;
+            }
+            if (m_queue.isEmpty()) break; // 已停止且队列排空
+            frame = m_queue.dequeue(); m_notFull.wakeOne();
+        }
+        // 高位深帧在这里先缩放再量化，整条管线只量化这一次
+        StageScope t(m_trace, RenderStage::Encode);
+        const cv::Mat *src = &frame;
+        if (frame.cols != m_width || frame.rows != m_height) { cv::resize(frame, scaled, cv::Size(m_width, m_height), 0, 0, cv::INTER_AREA); src = &scaled; }
+        if (src->depth() == CV_16U) { src->convertTo(quantized, CV_8U, 255.0/65535.0); src = &quantized; }
+        if (ok && !encoder->write(*src)) fail(encoder->lastError()); // 之后的帧只出队丢弃，生产者不会阻塞
+        QMutexLocker l(&m_mutex); if (ok) m_stats.framesWritten++;
+    }
+    if (!encoder->close() && opened) fail(encoder->lastError());
 }
 
 // ================= ProcessorThread Implementation =================
 void ProcessorThread::setParams(const ProcessParams &params) { m_params = params; }
 void ProcessorThread::stop() { m_running = false; }
+// 按输出分辨率保存(与编码器的缩放方式一致)，缩略图与封面对话框的显示高度一致
+// 分段渲染时由多个段线程同时调用
+void ProcessorThread::captureCover(int frameIndex, const cv::Mat &frame, cv::Size outSize) {
+    { QMutexLocker l(&m_coverMutex); for (const CoverCandidate &c : m_covers) if (c.frameIndex == frameIndex) return; }
+    CoverCandidate c; c.frameIndex = frameIndex;
+    if (frame.size() != outSize) cv::resize(frame, c.image, outSize, 0, 0, cv::INTER_AREA); else c.image = frame.clone();
+    if (c.image.depth() == CV_16U) c.image.convertTo(c.image, CV_8U, 255.0/65535.0); // 与编码器相同的量化
+    int dispH = 500; int dispW = (int)(c.image.cols * ((double)dispH / c.image.rows));
+    cv::Mat s; cv::resize(c.image, s, cv::Size(dispW, dispH), 0, 0, cv::INTER_AREA); c.thumb = matToQImage(s);
+    QMutexLocker l(&m_coverMutex); m_covers.append(c);
+}
+
+bool ProcessorThread::openSource(FrameProvider &provider) {
+    return m_params.isVideo ? provider.openVideo(m_params.videoPath) : provider.openSequence(m_params.imageFiles);
+}
+
+// 裁剪到合成尺寸；dst 已按 workSize 分配
+static void cropToWork(const cv::Mat &raw, const cv::Rect &crop, bool downscale, cv::Mat &dst) {
+    if (downscale) cv::resize(raw(crop), dst, dst.size(), 0, 0, cv::INTER_AREA); else raw(crop).copyTo(dst);
+}
+
+// 无限模式累加：frameHi 在裁剪后求出，accumLo 随累加器增量维护，不可能改变累加器的块整块跳过
+// 彗星模式不跳块：增量路径中每个新值都要进入各像素的候选栈(它会在旧候选过期后胜出)；
+// 融合路径每帧从零重建输出，可用的下界只有加权后的块最小值，噪声使它几乎总低于新帧的块最大值
+static void accumulateMax(const cv::Mat &f, const std::vector<ushort> &frameHi, cv::Mat &accum, std::vector<ushort> &accumLo, int threads, RenderTrace &trace) {
+    if (accum.empty()) { accum = f.clone(); accumLo.clear(); return; }
+    size_t skipped = CompositeKernels::maxTiledSkip(f, frameHi, accum, accumLo, threads);
+    trace.addBlocks((qint64)CompositeKernels::summaryBlocks(f), (qint64)skipped);
+}
+
+// 按顺序无损拼接分段文件(ffmpeg concat -c copy)；只有一个分段时直接复制
+static bool concatParts(const QString &ffmpeg, const QStringList &parts, const QString &outPath, QString &error) {
+    if (parts.isEmpty()) { error = "没有可拼接的分段"; return false; }
+    QFile::remove(outPath);
+    if (parts.size() == 1) { if (QFile::copy(parts.first(), outPath)) return true; error = "无法写入输出文件"; return false; }
+    QString listPath = outPath + ".parts.txt"; QFile list(listPath);
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Truncate)) { error = "无法写入分段列表"; return false; }
+    for (QString path : parts) list.write(QString("file '%1'\n").arg(path.replace("'", "'\\''")).toUtf8());
+    list.close();
+    QProcess proc; proc.start(ffmpeg, {"-hide_banner", "-loglevel", "error", "-y", "-f", "concat", "-safe", "0", "-i", listPath, "-c", "copy", outPath});
+    bool ok = proc.waitForFinished(-1) && proc.exitStatus() == QProcess::NormalExit && proc.exitCode() == 0;
+    if (!ok) error = "分段拼接失败: " + QString::fromLocal8Bit(proc.readAllStandardError()).trimmed();
+    QFile::remove(listPath); return ok;
+}
+
 void ProcessorThread::run() {
-    m_running = true; FrameProvider provider;
-    if (m_params.isVideo) { if(!provider.openVideo(m_params.videoPath)) { emit errorOccurred("无法打开视频"); return; } }
-    else { if(!provider.openSequence(m_params.imageFiles)) { emit errorOccurred("无法打开图片序列"); return; } }
+    m_running = true; m_covers.clear(); m_historyPeak = 0; FrameProvider provider;
+    m_trace.reset(!m_params.tracePath.isEmpty()); m_trace.nameThread("render");
+    if (!openSource(provider)) { emit errorOccurred(m_params.isVideo ? "无法打开视频" : "无法打开图片序列"); return; }
+    if (m_params.emitPreview) { m_preview.setMaxFps(m_params.previewFps); m_preview.start(); } // 素材打开失败时不启动预览线程
     cv::ocl::setUseOpenCL(m_params.useOpenCL);
     int total = provider.totalFrames();
     double fps = m_params.targetFps > 0 ? m_params.targetFps : 30.0;
@@ -345,35 +575,286 @@ void ProcessorThread::run() {
     cv::Rect cropRect = m_params.finalCropRect;
     int finalW = cropRect.width; int finalH = cropRect.height;
     if(m_params.targetRes>0 && m_params.targetRes<finalH) { double s = (double)m_params.targetRes/finalH; finalW=(int)(finalW*s); finalH=m_params.targetRes; }
-    VideoWriterWorker *writer = new VideoWriterWorker(m_params.outPath, finalW, finalH, fps, m_params.isMov);
-    writer->start();
-
     int start = std::max(0, m_params.startFrame); int end = std::min(total, m_params.endFrame); if(end<=start) end=total;
-    int processCount = end - start; provider.seek(start);
+    int processCount = end - start;
     bool infinite = m_params.trailLength >= processCount;
-    std::deque<cv::Mat> buffer; std::vector<float> weights; float fadeStart = std::max(0.05, 1.0 - m_params.fadeStrength);
-    for(int i=0; i<m_params.trailLength; ++i) { float t=(float)i/std::max(1,m_params.trailLength-1); weights.push_back(fadeStart+t*(1.0f-fadeStart)); }
-    cv::Mat g_accum; cv::UMat u_accum; QElapsedTimer timer; timer.start(); int p_h=360; int p_w=(int)(finalW*((double)p_h/finalH));
-
-    for(int i=0; i<processCount; ++i) {
-        if(!m_running) break; cv::Mat rawFrame; if(!provider.read(rawFrame)) break; cv::Mat frame_cpu = rawFrame(cropRect).clone(); cv::Mat finalFrame;
-        if(infinite) { if(m_params.useOpenCL) { cv::UMat u_frame = frame_cpu.getUMat(cv::ACCESS_READ); if(u_accum.empty()) u_accum=u_frame.clone(); else cv::max(u_accum, u_frame, u_accum); finalFrame = u_accum.getMat(cv::ACCESS_READ); } else { if(g_accum.empty()) g_accum=frame_cpu.clone(); else cv::max(g_accum, frame_cpu, g_accum); finalFrame=g_accum; } }
-        else { buffer.push_back(frame_cpu.clone()); if(buffer.size()>(size_t)m_params.trailLength) buffer.pop_front(); size_t bLen = buffer.size(); if(bLen>1) { int off=m_params.trailLength-bLen; cv::Mat accum; cv::convertScaleAbs(buffer[0], accum, weights[off]); cv::Mat tmp; for(size_t k=1; k<bLen; ++k) { float w=weights[off+k]; if(w>0.99f) cv::max(accum, buffer[k], accum); else { cv::convertScaleAbs(buffer[k], tmp, w); cv::max(accum, tmp, accum); } } finalFrame = accum; } else finalFrame = frame_cpu; }
-        writer->addFrame(finalFrame);
-        if(i%5==0) { cv::Mat small; cv::resize(finalFrame, small, cv::Size(p_w, p_h), 0, 0, cv::INTER_NEAREST); emit previewUpdated(matToQImage(small)); double e=timer.elapsed()/1000.0; emit progressUpdated(i+1, processCount, (e>0)?(i+1)/e:0); }
+
+    // 先缩放再合成：裁剪后的帧直接缩到输出尺寸，合成量与拖尾历史内存按面积比缩小
+    cv::Size outSize(finalW - finalW%2, finalH - finalH%2);
+    bool downscaleFirst = !m_params.fullResComposite && (outSize.width < cropRect.width || outSize.height < cropRect.height);
+    cv::Size workSize = downscaleFirst ? outSize : cropRect.size();
+
+    // 封面候选均匀分布在输出序列上，最后一个总是最后一帧；总内存限制在约 512MB
+    QList<int> coverAt; int nCovers = std::min({m_params.coverCandidates, processCount, (int)std::max<long long>(1, (512LL << 20) / ((long long)outSize.area() * 3))});
+    for(int k=1; k<=nCovers; ++k) coverAt << (int)((long long)k*processCount/nCovers) - 1;
+    if(m_params.coverFrame >= 0 && m_params.coverFrame < processCount && !coverAt.contains(m_params.coverFrame)) { coverAt << m_params.coverFrame; std::sort(coverAt.begin(), coverAt.end()); }
+
+    RenderPlan plan{start, processCount, infinite, cropRect, downscaleFirst, workSize, outSize, finalW, finalH, fps, coverAt, 1, 1};
+    int segments = segmentCount(plan); QString ffmpeg = QStandardPaths::findExecutable("ffmpeg");
+    // 编码后端在渲染开始前确定一次：分段与检查点文件用 -c copy 拼接，各分段不能各自回退到不同的后端
+    QString encoderExe = m_params.encoder.ffmpegPath.isEmpty() ? ffmpeg : m_params.encoder.ffmpegPath;
+    if(m_params.encoder.backend == EncoderSettings::FFmpegPipe && !QFileInfo(encoderExe).isExecutable()) { qDebug() << "未找到 ffmpeg 编码器，改用 OpenCV 编码"; m_params.encoder.backend = EncoderSettings::OpenCV; }
+    // 视频从中间开始解码(起始帧、分段、续渲)时先等关键帧索引，各分段才能精确落在边界帧上
+    if(m_params.isVideo && (start > 0 || segments > 1 || m_params.checkpointInterval > 0)) VideoIndex::get(m_params.videoPath, true);
+    if(segments > 1) {
+        if(!ffmpeg.isEmpty()) {
+            if(m_params.checkpointInterval > 0) qDebug() << "分段渲染不支持检查点续渲，本次不保存检查点";
+            provider.close(); runSegmented(plan, segments, ffmpeg); return;
+        }
+        qDebug() << "分段渲染需要 ffmpeg 拼接分段文件，未找到 ffmpeg，改为串行渲染";
+    }
+
+    // 检查点：输出按检查点切成分段文件，参数一致的旧检查点自动续渲；恢复点之前的帧不再解码合成
+    QScopedPointer<RenderCheckpoint> ckpt; int resumeAt = 0; cv::Mat g_accum;
+    if(m_params.checkpointInterval > 0) {
+        if(!m_params.extraOutputs.isEmpty()) qDebug() << "附加输出不支持检查点续渲，本次不保存检查点";
+        else if(ffmpeg.isEmpty()) qDebug() << "检查点需要 ffmpeg 拼接分段文件，未找到 ffmpeg，本次不保存检查点";
+        else {
+            QJsonObject fp; fp["source"] = m_params.isVideo ? m_params.videoPath : m_params.imageFiles.first(); fp["sourceFrames"] = total;
+            fp["start"] = start; fp["count"] = processCount; fp["crop"] = QJsonArray{cropRect.x, cropRect.y, cropRect.width, cropRect.height};
+            fp["out"] = QJsonArray{finalW, finalH}; fp["trail"] = infinite ? 0 : m_params.trailLength; fp["fade"] = m_params.fadeStrength; fp["fps"] = fps;
+            fp["nativeDepth"] = m_params.nativeDepth; fp["downscaleFirst"] = downscaleFirst; fp["mov"] = m_params.isMov; fp["historyTolerance"] = infinite ? -1 : m_params.historyTolerance;
+            // 分段拼接用 -c copy，各分段的编码参数必须一致
+            const EncoderSettings &enc = m_params.encoder; fp["encoder"] = QString("%1 %2 %3 %4 %5 %6").arg(enc.backend == EncoderSettings::FFmpegPipe ? "ffmpeg" : "opencv").arg(enc.codec).arg(enc.preset).arg(enc.crf).arg(enc.bitrateKbps).arg(enc.pixFmt);
+            ckpt.reset(new RenderCheckpoint(m_params.outPath, fp));
+            if(ckpt->load() && (!infinite || ckpt->loadAccum(g_accum))) { resumeAt = std::min(ckpt->committedFrames(), processCount); qDebug() << "从检查点恢复: 第" << resumeAt << "帧"; }
+            else { ckpt->clear(); g_accum.release(); }
+        }
+    }
+    // 彗星模式从恢复点前 trailLength-1 帧开始预热，拖尾历史与不间断渲染完全相同
+    int warm = infinite ? 0 : std::min(m_params.trailLength - 1, resumeAt);
+    provider.setReadAhead(m_params.readAheadDepth, m_params.decodeThreads); provider.setNativeDepth(m_params.nativeDepth); provider.setTrace(&m_trace); provider.seek(start + resumeAt - warm);
+
+    // 帧池容量：拖尾历史 + 写入队列 + 正在合成/编码的帧；池须在 writer/trail 之前构造
+    // 压缩拖尾历史不持有原始帧，池只需覆盖写入队列
+    bool fullHistory = !infinite && m_params.historyTolerance < 0;
+    int extraHeld = m_params.extraOutputs.size() * std::max(1, m_params.writerQueueCapacity);
+    FramePool pool((fullHistory ? m_params.trailLength : 0) + m_params.writerQueueCapacity + extraHeld + 4);
+    OutputFanout fanout(m_params.extraOutputs, m_params.outPath, outSize, fps, processCount, m_params.writerQueueCapacity, &pool, &m_trace);
+    int part = ckpt ? ckpt->partCount() : 0;
+    VideoWriterWorker *writer = new VideoWriterWorker(ckpt ? ckpt->partPath(part) : m_params.outPath, finalW, finalH, fps, m_params.isMov, m_params.writerQueueCapacity);
+    writer->setFramePool(&pool); writer->setTrace(&m_trace); writer->setEncoder(m_params.encoder); writer->setFallback(!ckpt); writer->start();
+    TrailEngine trail; trail.setAllocator(&pool); trail.setThreads(m_params.compositeThreads); trail.setHistoryTolerance(m_params.historyTolerance); if(!infinite) trail.reset(m_params.trailLength, m_params.fadeStrength);
+
+    // OpenCL：拖尾缓冲、合成、缩放都在设备上，只读回编码帧(延迟一帧)；不可用时走 CPU 路径
+    // 检查点需要逐帧对齐的累加器，开启检查点时走 CPU 路径
+    OclTrailPipeline ocl; bool useOcl = m_params.useOpenCL && !ckpt && ocl.reset(infinite ? 0 : m_params.trailLength, m_params.fadeStrength, outSize);
+    QElapsedTimer timer; timer.start(); int processed=0; cv::Mat rawFrame, lastOut;
+    WriterQueueStats ws; std::vector<ushort> frameHi, accumLo; // 无限模式的跳块摘要
+
+    // 输出一帧：入队编码、封面候选、预览与进度。shared 表示 f 之后不会再被修改，可直接入队
+    // 附加输出与主输出共享同一帧；会被继续修改的帧(无限模式累加器)只拷贝一次
+    auto emitFrame = [&](int idx, const cv::Mat &src, bool shared) {
+        cv::Mat f = src;
+        if(!shared && !fanout.isEmpty()) { StageScope t(&m_trace, RenderStage::Enqueue); f = pool.acquire(src.size(), src.type()); src.copyTo(f); shared = true; }
+        if(shared) writer->addSharedFrame(f); else writer->addFrame(f); fanout.push(idx, f); processed++; lastOut = f;
+        if(coverAt.contains(idx)) captureCover(idx, f, outSize);
+        if(m_params.emitPreview) { StageScope t(&m_trace, RenderStage::Preview); m_preview.post(f, shared); }
+        if(idx%5==0) { double e=timer.elapsed()/1000.0; emit progressUpdated(idx+1, processCount, (e>0)?processed/e:0); emit statsUpdated(m_trace.snapshot()); }
+    };
+    // 关闭当前分段并在后台保存检查点；上一次保存未完成时推迟到下一帧，不阻塞渲染
+    auto checkpoint = [&](int committed, bool rotate) {
+        VideoWriterWorker *done = writer; int donePart = part;
+        if(rotate) { writer = new VideoWriterWorker(ckpt->partPath(++part), finalW, finalH, fps, m_params.isMov, m_params.writerQueueCapacity); writer->setFramePool(&pool); writer->setTrace(&m_trace); writer->setEncoder(m_params.encoder); writer->setFallback(false); writer->start(); }
+        // 任一分段编码失败后不再写检查点，错误留到渲染结束时上报
+        ckpt->saveAsync([done, &ws]() { done->stop(); WriterQueueStats s = done->stats(); ws.producerStallMs += s.producerStallMs; ws.consumerIdleMs += s.consumerIdleMs; ws.maxDepth = std::max(ws.maxDepth, s.maxDepth); ws.capacity = s.capacity;
+                            if(s.failed() && !ws.failed()) ws.error = s.error; delete done; return !ws.failed(); },
+                        donePart, committed, infinite ? g_accum.clone() : cv::Mat());
+    };
+
+    int pushed=0, committed=resumeAt, lastCkpt=resumeAt;
+    for(int i=resumeAt-warm; i<processCount; ++i) {
+        if(!m_running) break; { StageScope t(&m_trace, RenderStage::Read); if(!provider.read(rawFrame)) break; }
+        cv::Mat frame_cpu = pool.acquire(workSize, rawFrame.type()); { StageScope t(&m_trace, RenderStage::Crop); cropToWork(rawFrame, cropRect, downscaleFirst, frame_cpu); if(infinite && !useOcl) CompositeKernels::blockMax(frame_cpu, frameHi, m_params.compositeThreads); } pushed++;
+        if(useOcl) { cv::Mat ready; bool have; { StageScope t(&m_trace, RenderStage::Composite); have = ocl.push(frame_cpu, ready, &pool); } if(have) emitFrame(i-1, ready, true); if(ocl.isValid()) continue;
+            // 中途回退：设备上的拖尾历史 / 无限模式累加器接到 CPU 引擎上，拖尾不会从头开始
+            useOcl = false; std::vector<cv::Mat> hist; ocl.download(hist, g_accum, &pool); accumLo.clear(); for(const cv::Mat &h : hist) trail.push(h);
+            qDebug() << "OpenCL 合成内核不可用，回退到 CPU 并接续设备上的合成状态"; }
+        if(infinite) { { StageScope t(&m_trace, RenderStage::Composite); accumulateMax(frame_cpu, frameHi, g_accum, accumLo, m_params.compositeThreads, m_trace); } emitFrame(i, g_accum, false); }
+        else { { StageScope t(&m_trace, RenderStage::Composite); trail.push(frame_cpu); } if(i >= resumeAt) emitFrame(i, trail.output(), true); } // 预热帧只进入拖尾历史
+        committed = i + 1;
+        if(ckpt && committed - lastCkpt >= m_params.checkpointInterval && committed < processCount && !ckpt->busy()) { checkpoint(committed, true); lastCkpt = committed; }
+    }
+    if(useOcl) { cv::Mat ready; if(ocl.flush(ready, &pool)) emitFrame(pushed-1, ready, true); }
+    int outputs = resumeAt + processed;
+    if(nCovers > 0 && processed > 0 && outputs < processCount) captureCover(outputs - 1, lastOut, outSize); // 中途停止时补上实际的最后一帧
+    if(m_params.emitPreview && !lastOut.empty()) m_preview.post(lastOut, true, true); // 最后一帧不受刷新间隔限制
+    m_preview.stop();
+
+    QString error;
+    if(ckpt) {
+        // 最后一个分段也写入检查点：停止后可续渲，正常完成后拼接并删除检查点目录
+        if(committed > lastCkpt) { ckpt->wait(); checkpoint(committed, false); } else { writer->stop(); WriterQueueStats s = writer->stats(); if(s.failed() && !ws.failed()) ws.error = s.error; delete writer; }
+        ckpt->wait(); writer = nullptr;
+        if(ws.failed()) error = ws.error; // 失败的分段不拼接，检查点停在最后一个完好的分段
+        else if(!concatParts(ffmpeg, ckpt->partPaths(ckpt->partCount()), m_params.outPath, error)) qDebug() << error;
+        else if(outputs >= processCount) ckpt->remove();
+    } else { writer->stop(); ws = writer->stats(); delete writer; if(ws.failed()) error = ws.error; }
+    QString extraError; if(!fanout.finish(extraError) && error.isEmpty()) error = extraError;
+    m_trace.addWriterQueue(ws.capacity, ws.maxDepth, ws.producerStallMs, ws.consumerIdleMs);
+    if(!useOcl) m_trace.setComposite(trail.threads(), (qint64)(infinite ? CompositeKernels::tileElems(lastOut.elemSize1() * 2) : trail.tileElems()));
+    if(!infinite && !useOcl) m_historyPeak = trail.peakHistoryBytes();
+    m_trace.addFramePool(pool.capacity(), pool.allocated(), pool.reuseCount(), pool.overflowCount());
+    if(!m_params.tracePath.isEmpty()) { qDebug() << "Stages:" << m_trace.snapshot().summary(); if(!m_trace.exportChrome(m_params.tracePath)) qDebug() << "无法写入 trace 文件" << m_params.tracePath; }
+    emit statsUpdated(m_trace.snapshot());
+    if(!error.isEmpty()) { emit errorOccurred(error); return; }
+    double e=timer.elapsed()/1000.0; emit progressUpdated(outputs, processCount, (e>0)?processed/e:0); emit finished(m_params.outPath);
+}
+
+// ================= 分段并行渲染 =================
+// 彗星模式第 i 帧只依赖 [i-trailLength+1, i]，无限模式是满足结合律的累计 max：时间轴可切成互不依赖的段，
+// 每段用独立的 FrameProvider 从段首打开、各自编码成分段文件，最后用 ffmpeg 无损拼接(-c copy)
+// 物理内存字节数；取不到时返回 0 (不限制)
+static qint64 physicalMemoryBytes() {
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX st; st.dwLength = sizeof(st); return GlobalMemoryStatusEx(&st) ? (qint64)st.ullTotalPhys : 0;
+#elif defined(Q_OS_UNIX)
+    long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGE_SIZE); return pages > 0 && page > 0 ? (qint64)pages * page : 0;
+#else
+    return 0;
+#endif
+}
+
+int ProcessorThread::segmentCount(const RenderPlan &plan) const {
+    if (m_params.segments <= 1 || m_params.useOpenCL || !m_params.extraOutputs.isEmpty()) return 1; // 附加输出需要按顺序得到全部帧
+    // 彗星模式每段要多解码 trailLength-1 帧预热，段长至少两倍拖尾，预热开销不超过一半
+    int minLen = plan.infinite ? 32 : std::max(32, 2 * m_params.trailLength);
+    int segments = std::max(1, std::min(m_params.segments, plan.count / minLen));
+    // 每段各自持有拖尾历史、写入队列与预读帧，段数受物理内存一半的预算限制 (3 通道，原位深按 16 位估算；压缩历史按 1/4 估算)
+    qint64 budget = physicalMemoryBytes() / 2; if (budget <= 0) return segments;
+    qint64 bpp = 3 * (m_params.nativeDepth ? 2 : 1);
+    qint64 history = plan.infinite ? 1 : (m_params.historyTolerance >= 0 ? std::max(1, m_params.trailLength / 4) : m_params.trailLength);
+    qint64 perSegment = bpp * ((qint64)plan.workSize.area() * (history + m_params.writerQueueCapacity + 4) + (qint64)plan.crop.area() * std::max(1, m_params.readAheadDepth));
+    int byMemory = (int)std::max<qint64>(1, std::min<qint64>(segments, budget / std::max<qint64>(1, perSegment)));
+    if (byMemory < segments) qDebug() << "分段渲染: 内存预算" << budget / 1048576 << "MB，段数从" << segments << "降为" << byMemory;
+    return byMemory;
+}
+
+bool ProcessorThread::scanSegmentMax(const RenderPlan &plan, int begin, int end, cv::Mat &accum) {
+    FrameProvider provider; if (!openSource(provider)) return false;
+    provider.setReadAhead(m_params.readAheadDepth, plan.segDecodeThreads); provider.setNativeDepth(m_params.nativeDepth); provider.setTrace(&m_trace); provider.seek(plan.start + begin);
+    m_trace.nameThread(QString("scan %1-%2").arg(begin).arg(end));
+    cv::Mat raw, f; std::vector<ushort> frameHi, accumLo;
+    for (int i = begin; i < end; ++i) {
+        if (!m_running) return false;
+        { StageScope t(&m_trace, RenderStage::Read); if (!provider.read(raw)) return false; }
+        { StageScope t(&m_trace, RenderStage::Crop); f.create(plan.workSize, raw.type()); cropToWork(raw, plan.crop, plan.downscaleFirst, f); CompositeKernels::blockMax(f, frameHi, plan.segThreads); }
+        StageScope t(&m_trace, RenderStage::Composite); accumulateMax(f, frameHi, accum, accumLo, plan.segThreads, m_trace);
+    }
+    return true;
+}
+
+bool ProcessorThread::renderSegment(const RenderPlan &plan, int seg, int begin, int end, const cv::Mat &carry, const QString &partPath, std::atomic<int> &done, const std::atomic<int> &previewSeg, QString &error) {
+    FrameProvider provider; if (!openSource(provider)) { error = m_params.isVideo ? "无法打开视频" : "无法打开图片序列"; return false; }
+    int warm = plan.infinite ? 0 : std::min(m_params.trailLength - 1, begin);
+    provider.setReadAhead(m_params.readAheadDepth, plan.segDecodeThreads);
+    provider.setNativeDepth(m_params.nativeDepth); provider.setTrace(&m_trace); provider.seek(plan.start + begin - warm);
+    m_trace.nameThread(QString("segment %1").arg(seg));
+
+    FramePool pool((plan.infinite || m_params.historyTolerance >= 0 ? 0 : m_params.trailLength) + m_params.writerQueueCapacity + 4);
+    VideoWriterWorker *writer = new VideoWriterWorker(partPath, plan.finalW, plan.finalH, plan.fps, m_params.isMov, m_params.writerQueueCapacity);
+    EncoderSettings enc = m_params.encoder; if (enc.threads <= 0) enc.threads = plan.segThreads; // 各段的 ffmpeg 分摊核心，避免 N 个编码器各占满全部核心
+    writer->setFramePool(&pool); writer->setTrace(&m_trace); writer->setEncoder(enc); writer->setFallback(false); writer->start(); // 各段必须同一后端才能 -c copy 拼接
+    TrailEngine trail; trail.setAllocator(&pool); trail.setThreads(plan.segThreads); trail.setHistoryTolerance(m_params.historyTolerance); if (!plan.infinite) trail.reset(m_params.trailLength, m_params.fadeStrength);
+
+    cv::Mat raw, accum = carry.empty() ? cv::Mat() : carry.clone(); bool ok = true; std::vector<ushort> frameHi, accumLo;
+    for (int i = begin - warm; i < end; ++i) {
+        if (!m_running) { ok = false; break; }
+        { StageScope t(&m_trace, RenderStage::Read); if (!provider.read(raw)) { ok = false; break; } }
+        cv::Mat f = pool.acquire(plan.workSize, raw.type()); { StageScope t(&m_trace, RenderStage::Crop); cropToWork(raw, plan.crop, plan.downscaleFirst, f); if (plan.infinite) CompositeKernels::blockMax(f, frameHi, plan.segThreads); }
+        { StageScope t(&m_trace, RenderStage::Composite); if (plan.infinite) accumulateMax(f, frameHi, accum, accumLo, plan.segThreads, m_trace); else trail.push(f); }
+        if (i < begin) continue; // 预热帧只进入拖尾历史，不输出
+        const cv::Mat &out = plan.infinite ? accum : trail.output();
+        if (plan.infinite) writer->addFrame(out); else writer->addSharedFrame(out);
+        if (plan.coverAt.contains(i)) captureCover(i, out, plan.outSize);
+        // 只有最靠前的未完成段更新预览，画面按时间顺序推进；邮箱比段内帧池活得久，必须拷贝不能共享
+        if (m_params.emitPreview && previewSeg.load() == seg) { StageScope t(&m_trace, RenderStage::Preview); m_preview.post(out, false); }
+        done++;
+    }
+    writer->stop(); WriterQueueStats ws = writer->stats(); delete writer; m_historyPeak += trail.peakHistoryBytes();
+    if (ws.failed()) { error = ws.error; ok = false; }
+    m_trace.addWriterQueue(ws.capacity, ws.maxDepth, ws.producerStallMs, ws.consumerIdleMs);
+    m_trace.addFramePool(pool.capacity(), pool.allocated(), pool.reuseCount(), pool.overflowCount());
+    if (seg == 0) m_trace.setComposite(trail.threads(), (qint64)(plan.infinite ? CompositeKernels::tileElems(accum.elemSize1() * 2) : trail.tileElems()));
+    return ok;
+}
+
+void ProcessorThread::runSegmented(const RenderPlan &basePlan, int segments, const QString &ffmpeg) {
+    RenderPlan plan = basePlan; plan.segThreads = std::max(1, CompositeKernels::effectiveThreads(m_params.compositeThreads) / segments);
+    plan.segDecodeThreads = std::max(1, m_params.decodeThreads / segments);
+    QVector<int> bounds; for (int k = 0; k <= segments; ++k) bounds << (int)((long long)k * plan.count / segments);
+    QFileInfo outInfo(m_params.outPath); QStringList parts;
+    for (int k = 0; k < segments; ++k) parts << outInfo.dir().filePath(QString("%1.part%2.%3").arg(outInfo.completeBaseName()).arg(k, 2, 10, QChar('0')).arg(outInfo.suffix()));
+    m_trace.setSegments(segments);
+    QElapsedTimer timer; timer.start();
+
+    // 无限模式：先并行求出各段自身的最大值，段 k 的累计结果从前面各段的最大值开始
+    std::vector<cv::Mat> carry(segments);
+    if (plan.infinite) {
+        std::vector<cv::Mat> segMax(segments); std::vector<char> scanned(segments, 0); QList<QThread*> scans;
+        for (int k = 0; k < segments - 1; ++k) scans << QThread::create([this, &plan, &bounds, &segMax, &scanned, k]() { scanned[k] = scanSegmentMax(plan, bounds[k], bounds[k + 1], segMax[k]); });
+        for (QThread *t : scans) t->start();
+        for (QThread *t : scans) { t->wait(); delete t; }
+        if (!m_running) { m_preview.stop(); emit statsUpdated(m_trace.snapshot()); emit finished(m_params.outPath); return; } // 与串行渲染一样，停止不算失败
+        // 某段扫描读帧失败时其最大值不完整，后续各段的起始累计会漏掉星轨，不能当作成功输出
+        for (int k = 0; k < segments - 1; ++k)
+            if (!scanned[k]) { m_preview.stop(); emit errorOccurred(QString("分段扫描读取失败(第 %1-%2 帧)").arg(plan.start + bounds[k]).arg(plan.start + bounds[k + 1] - 1)); return; }
+        for (int k = 1; k < segments; ++k) {
+            const cv::Mat &prev = segMax[k - 1];
+            if (carry[k - 1].empty()) carry[k] = prev.clone();
+            else { carry[k] = carry[k - 1].clone(); if (!prev.empty()) cv::max(carry[k], prev, carry[k]); }
+        }
     }
-    writer->stop(); delete writer; emit finished(m_params.outPath);
+
+    std::atomic<int> done(0), previewSeg(0); std::vector<char> complete(segments, 0); std::vector<QString> segErrors(segments); QList<QThread*> workers;
+    for (int k = 0; k < segments; ++k)
+        workers << QThread::create([this, &plan, &bounds, &carry, &parts, &done, &previewSeg, &complete, &segErrors, k]() { complete[k] = renderSegment(plan, k, bounds[k], bounds[k + 1], carry[k], parts[k], done, previewSeg, segErrors[k]); });
+    for (QThread *t : workers) t->start();
+    for (int k = 0; k < segments; ++k) {
+        while (!workers[k]->wait(250)) { double e = timer.elapsed() / 1000.0; emit progressUpdated(done.load(), plan.count, e > 0 ? done.load() / e : 0); emit statsUpdated(m_trace.snapshot()); }
+        previewSeg.store(k + 1);
+    }
+    qDeleteAll(workers);
+    m_preview.stop();
+
+    // 中途停止时只拼接从头连续完成的段，以及其后第一个(部分完成的)段
+    int use = 0; while (use < segments && complete[use]) use++;
+    if (use < segments && QFileInfo(parts[use]).size() > 0) use++;
+    // 任一分段编码或打开失败时整段输出不完整，不拼接，直接报告第一个错误
+    QString error; for (const QString &s : segErrors) if (!s.isEmpty()) { error = s; break; }
+    // 停止时还没有任何分段写出帧：与串行渲染一样按停止处理，不报拼接错误
+    if (error.isEmpty() && (use > 0 || m_running)) concatParts(ffmpeg, parts.mid(0, use), m_params.outPath, error);
+    for (const QString &p : parts) QFile::remove(p);
+
+    { QMutexLocker l(&m_coverMutex); std::sort(m_covers.begin(), m_covers.end(), [](const CoverCandidate &a, const CoverCandidate &b) { return a.frameIndex < b.frameIndex; }); }
+    if (!m_params.tracePath.isEmpty()) { qDebug() << "Stages:" << m_trace.snapshot().summary(); if (!m_trace.exportChrome(m_params.tracePath)) qDebug() << "无法写入 trace 文件" << m_params.tracePath; }
+    emit statsUpdated(m_trace.snapshot());
+    if (!error.isEmpty()) { emit errorOccurred(error); return; }
+    double e = timer.elapsed() / 1000.0; emit progressUpdated(done.load(), plan.count, e > 0 ? done.load() / e : 0); emit finished(m_params.outPath);
 }
 
 // ================= CoverSelectorDialog Implementation (Fixed) =================
 CoverSelectorDialog::CoverSelectorDialog(QString videoPath, QWidget *parent)
     : QDialog(parent), m_videoPath(videoPath)
 {
+    m_reader = new VideoFrameReader(videoPath, 256); // 最近解码帧缓存，来回拖动滑块不重复解码
+    m_totalFrames = (int)m_reader->get(cv::CAP_PROP_FRAME_COUNT);
+    m_currentIdx = m_totalFrames - 1;
+    setupUi();
+}
+
+CoverSelectorDialog::CoverSelectorDialog(const QList<CoverCandidate> &candidates, QWidget *parent)
+    : QDialog(parent), m_reader(nullptr), m_candidates(candidates)
+{
+    // 滑块在候选之间移动，默认选中最后一帧
+    m_totalFrames = m_candidates.size();
+    m_currentIdx = m_totalFrames - 1;
+    setupUi();
+}
+
+void CoverSelectorDialog::setupUi() {
     setWindowTitle("选择实况封面");
     resize(800, 600);
-    m_cap = new cv::VideoCapture(videoPath.toStdString());
-    m_totalFrames = (int)m_cap->get(cv::CAP_PROP_FRAME_COUNT);
-    m_currentIdx = m_totalFrames - 1;
 
     QVBoxLayout *lay = new QVBoxLayout(this);
     m_lblPreview = new QLabel;
@@ -406,20 +887,27 @@ CoverSelectorDialog::CoverSelectorDialog(QString videoPath, QWidget *parent)
 }
 
 CoverSelectorDialog::~CoverSelectorDialog() {
-    if (m_cap) { m_cap->release(); delete m_cap; }
+    delete m_reader;
 }
 
 void CoverSelectorDialog::onSliderValueChanged(int v) {
     m_currentIdx = v;
-    m_lblInfo->setText(QString("%1/%2").arg(v).arg(m_totalFrames));
+    if (!m_candidates.isEmpty()) m_lblInfo->setText(QString("第 %1 帧").arg(m_candidates[v].frameIndex + 1));
+    else m_lblInfo->setText(QString("%1/%2").arg(v).arg(m_totalFrames));
     updatePreview();
 }
 
 void CoverSelectorDialog::updatePreview() {
-    if (!m_cap) return;
-    m_cap->set(cv::CAP_PROP_POS_FRAMES, m_currentIdx);
+    if (!m_candidates.isEmpty()) {
+        if (m_currentIdx < 0 || m_currentIdx >= m_candidates.size()) return;
+        const CoverCandidate &c = m_candidates[m_currentIdx];
+        m_selectedFrame = c.image;
+        m_lblPreview->setPixmap(QPixmap::fromImage(c.thumb));
+        return;
+    }
+    if (!m_reader) return;
     cv::Mat f;
-    if (m_cap->read(f)) {
+    if (m_reader->frameAt(m_currentIdx, f)) {
         m_selectedFrame = f.clone();
         int h = f.rows; int dispH = 500; int dispW = (int)(f.cols * ((double)dispH / h));
         cv::Mat s; cv::resize(f, s, cv::Size(dispW, dispH));
@@ -434,13 +922,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_inputProvider(n
     setupUi();
     m_processor = new ProcessorThread;
     connect(m_processor, &ProcessorThread::progressUpdated, this, &MainWindow::onProgress);
-    connect(m_processor, &ProcessorThread::previewUpdated, this, &MainWindow::onPreviewUpdated);
+    connect(m_processor->previewMailbox(), &PreviewMailbox::previewReady, this, &MainWindow::onPreviewReady);
+    connect(m_processor, &ProcessorThread::statsUpdated, this, &MainWindow::onStatsUpdated);
     connect(m_processor, &ProcessorThread::finished, this, &MainWindow::onProcessingFinished);
     connect(m_processor, &ProcessorThread::errorOccurred, this, [this](QString m){ QMessageBox::critical(this, "Error", m); m_btnStart->setEnabled(true); });
 }
 MainWindow::~MainWindow() { if(m_processor->isRunning()) { m_processor->stop(); m_processor->wait(); } delete m_inputProvider; }
 void MainWindow::setupUi() {
-    setWindowTitle("StarTrail v1.0.0"); resize(1100, 750); setStyleSheet(ULTRA_DARK_STYLE);
+    setWindowTitle(QString("StarTrail v%1").arg(STARTRAILS_VERSION)); resize(1100, 750); setStyleSheet(ULTRA_DARK_STYLE);
     QWidget *cen = new QWidget; setCentralWidget(cen); QHBoxLayout *mainLay = new QHBoxLayout(cen); mainLay->setContentsMargins(0,0,0,0); mainLay->setSpacing(0);
     QFrame *side = new QFrame; side->setFixedWidth(320); side->setStyleSheet("background: #181818; border-right: 1px solid #333;");
     QVBoxLayout *sLay = new QVBoxLayout(side); sLay->setContentsMargins(15,25,15,25); sLay->setSpacing(15);
@@ -453,14 +942,15 @@ void MainWindow::setupUi() {
     connect(m_btnStart, &QPushButton::clicked, this, &MainWindow::selectOutputPath); sLay->addWidget(m_btnStart); mainLay->addWidget(side);
     QWidget *pre = new QWidget; QVBoxLayout *prl = new QVBoxLayout(pre); m_lblPreview = new QLabel("PREVIEW"); m_lblPreview->setAlignment(Qt::AlignCenter); m_lblPreview->setStyleSheet("background: #000; border-radius: 6px;"); m_lblPreview->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding); prl->addWidget(m_lblPreview);
     QHBoxLayout *inf = new QHBoxLayout; m_lblStatus = new QLabel("Ready"); m_lblSpeed = new QLabel(""); inf->addWidget(m_lblStatus); inf->addStretch(); inf->addWidget(m_lblSpeed); prl->addLayout(inf);
+    m_lblStats = new QLabel(""); m_lblStats->setStyleSheet("color: #888; font-size: 11px;"); prl->addWidget(m_lblStats);
     m_progressBar = new QProgressBar; prl->addWidget(m_progressBar); mainLay->addWidget(pre);
 }
 void MainWindow::onFilesDropped(QStringList paths) {
     if(paths.isEmpty()) return; QStringList validImages;
-    for(const QString &p : paths) { QFileInfo fi(p); if(fi.isDir()) { QDir dir(p); QStringList filters = {"*.jpg", "*.jpeg", "*.png", "*.tif", "*.tiff", "*.dng", "*.cr2", "*.nef", "*.arw"}; QStringList imgs = dir.entryList(filters, QDir::Files); for(const QString &img : imgs) validImages.append(dir.filePath(img)); } else { QString ext = fi.suffix().toLower(); if(ext == "mp4" || ext == "mov" || ext == "avi" || ext == "mkv") { if(m_inputProvider->openVideo(p)) { m_lblFileName->setText("视频: " + fi.fileName()); m_btnStart->setEnabled(true); return; } } else { validImages.append(p); } } }
+    for(const QString &p : paths) { QFileInfo fi(p); if(fi.isDir()) { QStringList filters = {"*.jpg", "*.jpeg", "*.png", "*.tif", "*.tiff", "*.dng", "*.cr2", "*.nef", "*.arw"}; SequenceInfo seq; if(SequenceManifest::openDirectory(p, filters, seq)) validImages.append(seq.files); } else { QString ext = fi.suffix().toLower(); if(ext == "mp4" || ext == "mov" || ext == "avi" || ext == "mkv") { if(m_inputProvider->openVideo(p)) { m_lblFileName->setText("视频: " + fi.fileName()); m_btnStart->setEnabled(true); return; } } else { validImages.append(p); } } }
     if(!validImages.isEmpty()) { if(m_inputProvider->openSequence(validImages)) { m_lblFileName->setText(QString("图片序列: %1 张").arg(validImages.size())); m_btnStart->setEnabled(true); } else { QMessageBox::warning(this, "Error", "无法加载图片序列"); } }
 }
-void MainWindow::selectInput() { QString p = QFileDialog::getOpenFileName(this, "选择视频或第一张图片", "", "Media (*.mp4 *.mov *.dng *.jpg *.png *.tif);;All (*.*)"); if(!p.isEmpty()) { QStringList lst; lst << p; QString ext = QFileInfo(p).suffix().toLower(); if(ext != "mp4" && ext != "mov" && ext != "avi") { QDir dir = QFileInfo(p).dir(); QStringList filters = {"*."+ext}; QStringList siblings = dir.entryList(filters, QDir::Files); if(siblings.size() > 1) { if(QMessageBox::question(this, "序列检测", QString("检测到同目录下有 %1 张图片，是否作为序列导入？").arg(siblings.size())) == QMessageBox::Yes) { QStringList fullPaths; for(const QString &s : siblings) fullPaths << dir.filePath(s); onFilesDropped(fullPaths); return; } } } onFilesDropped(lst); } }
+void MainWindow::selectInput() { QString p = QFileDialog::getOpenFileName(this, "选择视频或第一张图片", "", "Media (*.mp4 *.mov *.dng *.jpg *.png *.tif);;All (*.*)"); if(!p.isEmpty()) { QStringList lst; lst << p; QString ext = QFileInfo(p).suffix().toLower(); if(ext != "mp4" && ext != "mov" && ext != "avi") { SequenceInfo seq; if(SequenceManifest::openDirectory(QFileInfo(p).absolutePath(), {"*."+ext}, seq) && seq.files.size() > 1) { if(QMessageBox::question(this, "序列检测", QString("检测到同目录下有 %1 张图片，是否作为序列导入？").arg(seq.files.size())) == QMessageBox::Yes) { onFilesDropped(seq.files); return; } } } onFilesDropped(lst); } }
 void MainWindow::selectOutputPath() {
     if (!m_inputProvider->isOpened()) return;
     RenderConfigDialog dlg(m_inputProvider, this);
@@ -476,9 +966,11 @@ void MainWindow::startRenderPipeline(RenderSettings settings, QString savePath)
     m_btnStart->setEnabled(false); m_dropLabel->setEnabled(false); m_wantLivePhoto = settings.exportLivePhoto; m_wantVideo = settings.exportVideo;
     ProcessParams p; p.isVideo = m_inputProvider->isVideo();
     if(p.isVideo) p.videoPath = m_inputProvider->getSourcePath();
-    else { QFileInfo firstFile(m_inputProvider->getSourcePath()); QDir dir = firstFile.dir(); QStringList filters; filters << "*." + firstFile.suffix(); QStringList fList = dir.entryList(filters, QDir::Files); fList.sort(); for(const QString &f : fList) p.imageFiles << dir.filePath(f); }
-    p.outPath = savePath; p.trailLength = m_spinTrail->value(); p.fadeStrength = m_spinFade->value(); p.targetRes = settings.targetHeight; p.isMov = (settings.outputFormat == ".mov"); p.useOpenCL = settings.useOpenCL; p.startFrame = settings.startFrame; p.endFrame = settings.endFrame; p.targetFps = settings.targetFps;
+    else { QFileInfo firstFile(m_inputProvider->getSourcePath()); SequenceInfo seq; if(SequenceManifest::openDirectory(firstFile.absolutePath(), {"*." + firstFile.suffix().toLower()}, seq)) p.imageFiles = seq.files; }
+    p.outPath = savePath; p.trailLength = m_spinTrail->value(); p.fadeStrength = m_spinFade->value(); p.targetRes = settings.targetHeight; p.isMov = (settings.outputFormat == ".mov"); p.useOpenCL = settings.useOpenCL; p.startFrame = settings.startFrame; p.endFrame = settings.endFrame; p.targetFps = settings.targetFps; p.decodeThreads = std::max(1, QThread::idealThreadCount() / 2); p.coverCandidates = m_wantLivePhoto ? 24 : 0; p.fullResComposite = settings.fullResComposite; p.encoder.backend = settings.ffmpegEncoder ? EncoderSettings::FFmpegPipe : EncoderSettings::OpenCV; p.historyTolerance = settings.compressHistory ? 2 : -1;
+    p.extraOutputs = settings.extraOutputs; for (OutputTarget &t : p.extraOutputs) { t.encoder = p.encoder; t.path = t.resolvedPath(savePath); }
     if (settings.cropRatioMode == 99 && !settings.manualCropRect.isEmpty()) { QRect r = settings.manualCropRect; p.finalCropRect = cv::Rect(r.x(), r.y(), r.width(), r.height()); } else { p.finalCropRect = calculateRatioCrop(m_inputProvider->width(), m_inputProvider->height(), settings.cropRatioMode); }
+    m_processor->previewMailbox()->setTargetSize(m_lblPreview->size() * m_lblPreview->devicePixelRatioF());
     m_processor->setParams(p); m_processor->start();
 }
 void MainWindow::onProcessingFinished(QString outPath) {
@@ -490,9 +982,10 @@ void MainWindow::onProcessingFinished(QString outPath) {
         // 先生成了一个视频文件 outPath
         // 现在要让用户选封面，并生成最终的 Motion Photo (JPG)
 
-        CoverSelectorDialog dlg(outPath, this);
-        if (dlg.exec() == QDialog::Accepted) {
-            cv::Mat cover = dlg.getSelectedImage();
+        QList<CoverCandidate> covers = m_processor->coverCandidates(); QString liveVideo = m_processor->livePhotoVideo();
+        QScopedPointer<CoverSelectorDialog> dlg(covers.isEmpty() ? new CoverSelectorDialog(liveVideo, this) : new CoverSelectorDialog(covers, this));
+        if (dlg->exec() == QDialog::Accepted) {
+            cv::Mat cover = dlg->getSelectedImage();
 
             // 构造输出的 JPG 路径 (同目录)
             QFileInfo vi(outPath);
@@ -503,8 +996,9 @@ void MainWindow::onProcessingFinished(QString outPath) {
             cv::imwrite(tempJpg.toStdString(), cover);
 
             // 调用合成器
-            bool ok = MotionPhotoMuxer::mux(tempJpg, outPath, finalJpgPath);
+            bool ok = MotionPhotoMuxer::mux(tempJpg, liveVideo, finalJpgPath);
             QFile::remove(tempJpg); // 清理
+            if(ok && liveVideo != outPath) QFile::remove(liveVideo); // 实况短片已内嵌
 
             QString msg = ok ? "成功生成动态照片: " + finalJpgPath : "动态照片合成失败";
             if(ok && !m_wantVideo) QFile::remove(outPath); // 如果只想要实况，删掉中间视频
@@ -516,5 +1010,11 @@ void MainWindow::onProcessingFinished(QString outPath) {
     }
 }
 void MainWindow::exportLivePhotoFlow(QString videoPath) { /* Unused now, logic moved to onProcessingFinished */ }
-void MainWindow::onPreviewUpdated(QImage img) { m_lblPreview->setPixmap(QPixmap::fromImage(img).scaled(m_lblPreview->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation)); }
+// 预览图已在预览线程缩放到标签的物理像素尺寸，这里只贴图；顺带把当前标签尺寸告诉信箱，窗口缩放后下一张即跟上
+void MainWindow::onPreviewReady() {
+    PreviewMailbox *box = m_processor->previewMailbox(); qreal dpr = m_lblPreview->devicePixelRatioF(); box->setTargetSize(m_lblPreview->size() * dpr);
+    QImage img; if (!box->take(img)) return;
+    QPixmap pm = QPixmap::fromImage(img); pm.setDevicePixelRatio(dpr); m_lblPreview->setPixmap(pm);
+}
 void MainWindow::onProgress(int c, int t, double fps) { m_progressBar->setMaximum(t); m_progressBar->setValue(c); m_lblStatus->setText(QString("处理中... %1/%2").arg(c).arg(t)); m_lblSpeed->setText(QString::number(fps, 'f', 1) + " FPS"); }
+void MainWindow::onStatsUpdated(RenderStats stats) { m_lblStats->setText(stats.summary()); }
@@ -21,6 +21,8 @@
 #include <QButtonGroup>
 #include <QPainter>
 #include <QMouseEvent>
+#include <QMap>
+#include <atomic>
 #include <deque>
 #include <vector>
 
@@ -28,6 +30,18 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/ocl.hpp>
 
+#include "RenderTrace.h"
+#include "PreviewMailbox.h"
+#include "VideoEncoder.h"
+#include "SequenceManifest.h"
+#include "VideoIndex.h"
+#include "RenderOutputs.h"
+
+#define STARTRAILS_VERSION "1.0.0"
+
+class FramePool;
+class ProxyCache;
+
 // --- 样式表 ---
 const QString ULTRA_DARK_STYLE = R"(
 QMainWindow, QDialog { background-color: #181818; }
@@ -60,6 +74,41 @@ public:
     static bool mux(const QString &jpgPath, const QString &mp4Path, const QString &outPath);
 };
 
+// --- 辅助函数 ---
+cv::Mat customImread(const QString &path);
+// 预先告诉 customImread 该文件所在序列的 RAW 页序号(来自序列清单)，省去首帧的 IFD 解析
+void rememberTiffPage(const QString &path, int page);
+QImage matToQImage(const cv::Mat &mat);
+cv::Rect calculateRatioCrop(int w, int h, int mode);
+
+// --- 序列预读器 ---
+// 多个解码线程按序号提前解码后续文件，重排缓冲区保证按序交付
+class SequencePrefetcher {
+public:
+    SequencePrefetcher(const QStringList &files, int w, int h, int depth, int workers, bool nativeDepth = false, RenderTrace *trace = nullptr);
+    ~SequencePrefetcher();
+    // 阻塞直到第 index 帧解码完成；index 不连续时视为 seek，丢弃已预读的帧
+    bool take(int index, cv::Mat &image);
+
+private:
+    void workerLoop();
+
+    QStringList m_files;
+    int m_w, m_h;
+    int m_depth;
+    bool m_nativeDepth;
+    RenderTrace *m_trace;
+    QList<QThread*> m_workers;
+    QMutex m_mutex;
+    QWaitCondition m_workCond;
+    QWaitCondition m_readyCond;
+    QMap<int, cv::Mat> m_ready;
+    int m_nextDecode;
+    int m_consumeIndex;
+    int m_generation;
+    bool m_stopping;
+};
+
 // --- 帧提供者 ---
 class FrameProvider {
 public:
@@ -67,6 +116,8 @@ public:
     ~FrameProvider();
     bool openVideo(const QString &path);
     bool openSequence(const QStringList &files);
+    // 已由 SequenceManifest 得到文件列表与尺寸时直接打开，不再读首帧
+    bool openSequence(const SequenceInfo &info);
     void close();
     bool isOpened() const;
     int totalFrames() const;
@@ -75,18 +126,31 @@ public:
     int height() const;
     bool isVideo() const { return m_isVideo; }
     QString getSourcePath() const;
+    QStringList files() const { return m_files; }
     bool read(cv::Mat &image);
     bool seek(int frameIndex);
+    // 图片序列预读：depth 帧预读深度，workers 解码线程数，任一为 0 时关闭
+    void setReadAhead(int depth, int workers);
+    // 保留 16 位源数据(默认降为 8 位)，量化推迟到编码器
+    void setNativeDepth(bool on);
+    // 记录 decode 阶段耗时(序列预读时在解码线程上)
+    void setTrace(RenderTrace *trace) { m_trace = trace; }
+    static bool decodeSequenceFrame(const QString &path, int w, int h, cv::Mat &image, bool nativeDepth = false);
 
 private:
     bool m_isVideo;
-    cv::VideoCapture *m_cap;
+    VideoFrameReader *m_video;
     QStringList m_files;
     int m_currentIndex;
     int m_total;
     int m_w, m_h;
     double m_fps;
     QString m_mainPath;
+    int m_readAheadDepth;
+    int m_decodeWorkers;
+    bool m_nativeDepth;
+    RenderTrace *m_trace;
+    SequencePrefetcher *m_prefetcher;
 };
 
 // --- 拖拽标签 ---
@@ -147,6 +211,10 @@ struct RenderSettings {
     int cropRatioMode;
     QRect manualCropRect;
     double targetFps;
+    bool fullResComposite;
+    bool ffmpegEncoder;
+    bool compressHistory;
+    QList<OutputTarget> extraOutputs; // 路径未定，由主输出路径派生
 };
 
 // --- 渲染配置对话框 ---
@@ -164,14 +232,22 @@ private slots:
     void onTimelineChanged(int value);
     void onSetStartClicked();
     void onSetEndClicked();
+    void onProxyReady(int index);
 
 private:
+    void showTimelinePreview(int index);
+
     QComboBox *m_cmbRes;
     QRadioButton *m_rbVideoOnly;
     QRadioButton *m_rbLivePhoto;
     QRadioButton *m_rbBoth;
     QCheckBox *m_chkOpenCL;
+    QCheckBox *m_chkFullRes;
+    QCheckBox *m_chkCompressHistory;
+    QCheckBox *m_chkSocialCut;
+    QCheckBox *m_chkLiveClip;
     QComboBox *m_cmbFormat;
+    QComboBox *m_cmbEncoder;
     QDoubleSpinBox *m_spinFps;
 
     QSpinBox *m_spinStartFrame;
@@ -183,6 +259,7 @@ private:
     QRect m_currentManualRect;
 
     FrameProvider *m_provider;
+    ProxyCache *m_proxy;
 
     QLabel *m_lblVideoPreview;
     QSlider *m_sliderTimeline;
@@ -190,22 +267,57 @@ private:
 };
 
 // --- 视频写入工作线程 ---
+// 写入队列统计：生产者阻塞时间长说明编码是瓶颈，消费者空闲时间长说明合成是瓶颈
+struct WriterQueueStats {
+    qint64 framesQueued = 0;
+    qint64 framesWritten = 0;
+    double producerStallMs = 0;
+    double consumerIdleMs = 0;
+    int maxDepth = 0;
+    int capacity = 0;
+    QString error;            // 打开、写入或关闭编码器失败的原因；之后的帧只出队丢弃
+    bool failed() const { return !error.isEmpty(); }
+};
+
 class VideoWriterWorker : public QThread {
     Q_OBJECT
 public:
-    VideoWriterWorker(QString path, int w, int h, double fps, bool isMov);
+    VideoWriterWorker(QString path, int w, int h, double fps, bool isMov, int queueCapacity = 15);
+    // 设置后入队帧拷贝进池中缓冲，而不是每帧 clone()
+    void setFramePool(FramePool *pool) { m_pool = pool; }
+    // 记录 enqueue(含队列满时的等待)与 encode(缩放/量化/编码)阶段耗时
+    void setTrace(RenderTrace *trace) { m_trace = trace; }
+    // 编码后端，须在 start() 之前设置；ffmpeg 打开失败时回退到 OpenCV
+    void setEncoder(const EncoderSettings &settings) { m_encoder = settings; }
+    // 关闭回退：要用 -c copy 拼接的分段必须使用同一后端，打开失败直接记为错误
+    void setFallback(bool allow) { m_fallback = allow; }
+    // 队列满时阻塞，直到编码线程取走一帧
     void addFrame(const cv::Mat &frame);
+    // 直接入队引用，调用方保证之后不再修改该帧
+    void addSharedFrame(const cv::Mat &frame);
     void stop();
+    int queueCapacity() const { return m_capacity; }
+    WriterQueueStats stats();
 protected:
     void run() override;
 private:
+    void enqueue(const cv::Mat &frame);
+
     QString m_path;
     int m_width, m_height;
     double m_fps;
-    bool m_running;
+    bool m_isMov;
+    EncoderSettings m_encoder;
+    bool m_fallback;
+    int m_capacity;
+    std::atomic<bool> m_running;
+    FramePool *m_pool;
+    RenderTrace *m_trace;
     QQueue<cv::Mat> m_queue;
     QMutex m_mutex;
-    QWaitCondition m_condition;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    WriterQueueStats m_stats;
 };
 
 // --- 主处理线程 ---
@@ -219,11 +331,34 @@ struct ProcessParams {
     double fadeStrength;
     int targetRes;
     bool isMov;
+    EncoderSettings encoder;
     bool useOpenCL;
     int startFrame;
     int endFrame;
     cv::Rect finalCropRect;
     double targetFps;
+    int readAheadDepth = 8;
+    int decodeThreads = 2;
+    int writerQueueCapacity = 15;
+    int compositeThreads = 0;  // 分块合成的线程数，0 = 全部核心
+    int segments = 1;          // 分段并行渲染的段数(需要 ffmpeg 拼接)，1 = 串行
+    int checkpointInterval = 0; // 每隔多少输出帧保存一次检查点(需要 ffmpeg 拼接)，0 = 关闭
+    QString tracePath;         // 非空时把整次渲染的阶段事件导出为 Chrome trace JSON
+    bool nativeDepth = true;   // 16 位序列按 16 位合成，只在编码时量化一次
+    bool fullResComposite = true; // 降分辨率导出时仍按裁剪原尺寸合成(与旧版输出一致)；false = 先缩放再合成，输出像素会变化
+    int historyTolerance = -1; // 彗星拖尾历史压缩的误差上限(8 位灰阶)，-1 = 保存完整帧
+    bool emitPreview = true;
+    double previewFps = 10.0; // 预览刷新率上限，与渲染速度无关
+    int coverCandidates = 0;   // 渲染时均匀保留的无损封面候选数，0 = 不保留
+    int coverFrame = -1;       // 额外保留的输出帧序号，-1 = 无
+    QList<OutputTarget> extraOutputs; // 与主输出共用同一次解码合成的附加视频(开启时不分段、不存检查点)
+};
+
+// 渲染时保留的封面候选：输出分辨率的原始像素 + 预览缩略图
+struct CoverCandidate {
+    int frameIndex;
+    cv::Mat image;
+    QImage thumb;
 };
 
 class ProcessorThread : public QThread {
@@ -231,10 +366,19 @@ class ProcessorThread : public QThread {
 public:
     void setParams(const ProcessParams &params);
     void stop();
+    // finished 之后有效
+    QList<CoverCandidate> coverCandidates() const { return m_covers; }
+    RenderStats renderStats() const { return m_trace.snapshot(); }
+    // 拖尾历史峰值内存(字节)，分段渲染时为各段之和
+    size_t historyPeakBytes() const { return m_historyPeak; }
+    // 实况照片应内嵌的视频(实况短片附加输出或主输出)
+    QString livePhotoVideo() const { return livePhotoVideoPath(m_params.outPath, m_params.extraOutputs); }
+    // 预览信箱：previewReady 后在界面线程 take() 取图
+    PreviewMailbox *previewMailbox() { return &m_preview; }
 
 signals:
     void progressUpdated(int current, int total, double fps);
-    void previewUpdated(QImage img);
+    void statsUpdated(RenderStats stats);
     void finished(QString outPath);
     void errorOccurred(QString msg);
 
@@ -242,8 +386,33 @@ protected:
     void run() override;
 
 private:
+    // 一次渲染的公共参数，串行与分段渲染共用；帧序号均相对于 start
+    struct RenderPlan {
+        int start, count;
+        bool infinite;
+        cv::Rect crop;
+        bool downscaleFirst;
+        cv::Size workSize, outSize;
+        int finalW, finalH;
+        double fps;
+        QList<int> coverAt;
+        int segThreads, segDecodeThreads;   // 分段渲染时每段的合成/解码线程数
+    };
+
+    bool openSource(FrameProvider &provider);
+    void captureCover(int frameIndex, const cv::Mat &frame, cv::Size outSize);
+    int segmentCount(const RenderPlan &plan) const;
+    void runSegmented(const RenderPlan &plan, int segments, const QString &ffmpeg);
+    bool renderSegment(const RenderPlan &plan, int seg, int begin, int end, const cv::Mat &carry, const QString &partPath, std::atomic<int> &done, const std::atomic<int> &previewSeg, QString &error);
+    bool scanSegmentMax(const RenderPlan &plan, int begin, int end, cv::Mat &accum);
+
     ProcessParams m_params;
     bool m_running;
+    QList<CoverCandidate> m_covers;
+    QMutex m_coverMutex;
+    RenderTrace m_trace;
+    PreviewMailbox m_preview;
+    std::atomic<size_t> m_historyPeak{0};
 };
 
 // --- 封面选择对话框 ---
@@ -251,14 +420,19 @@ class CoverSelectorDialog : public QDialog {
     Q_OBJECT
 public:
     explicit CoverSelectorDialog(QString videoPath, QWidget *parent = nullptr);
+    // 使用渲染时保留的候选帧，无需重新解码输出视频
+    CoverSelectorDialog(const QList<CoverCandidate> &candidates, QWidget *parent = nullptr);
     ~CoverSelectorDialog();
     cv::Mat getSelectedImage();
 private slots:
     void onSliderValueChanged(int value);
     void updatePreview();
 private:
+    void setupUi();
+
     QString m_videoPath;
-    cv::VideoCapture *m_cap;
+    VideoFrameReader *m_reader;
+    QList<CoverCandidate> m_candidates;
     int m_totalFrames;
     int m_currentIdx;
     cv::Mat m_selectedFrame;
@@ -281,8 +455,9 @@ private slots:
     void selectOutputPath();
 
     void onProcessingFinished(QString outPath);
-    void onPreviewUpdated(QImage img);
+    void onPreviewReady();
     void onProgress(int current, int total, double fps);
+    void onStatsUpdated(RenderStats stats);
 
 private:
     void setupUi();
@@ -298,6 +473,7 @@ private:
     QLabel *m_lblPreview;
     QLabel *m_lblStatus;
     QLabel *m_lblSpeed;
+    QLabel *m_lblStats;
     QProgressBar *m_progressBar;
 
     ProcessorThread *m_processor;
@@ -0,0 +1,109 @@
+#include "OclTrailPipeline.h"
+#include <opencv2/imgproc.hpp>
+#include <QDebug>
+
+// accum = init ? saturate(|src * w|) : max(accum, saturate(|src * w|))
+// convert_*_sat_rte 与 cvRound 一样就近取偶；不开启 fast-math，乘法按 IEEE 单精度取整
+static const char *kWeightedMaxSource = R"CLC(
+__kernel void weighted_max(__global const uchar *srcptr, int src_step, int src_offset,
+                           __global uchar *dstptr, int dst_step, int dst_offset, int rows, int cols,
+                           float w, int init)
+{
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows) return;
+    __global const T *s = (__global const T *)(srcptr + mad24(y, src_step, mad24(x, (int)sizeof(T), src_offset)));
+    __global T *d = (__global T *)(dstptr + mad24(y, dst_step, mad24(x, (int)sizeof(T), dst_offset)));
+    T v = CONVERT(fabs(convert_float(*s) * w));
+    *d = init ? v : max(*d, v);
+}
+)CLC";
+
+// ================= OclTrailPipeline Implementation =================
+OclTrailPipeline::OclTrailPipeline() : m_valid(false), m_trailLength(0), m_head(0), m_count(0), m_cur(0), m_pending(false) {}
+
+bool OclTrailPipeline::available() { return cv::ocl::haveOpenCL() && cv::ocl::useOpenCL(); }
+
+bool OclTrailPipeline::reset(int trailLength, double fadeStrength, cv::Size outSize) {
+    m_valid = available(); m_outSize = outSize;
+    m_trailLength = std::max(0, trailLength); m_weights.clear();
+    float fadeStart = std::max(0.05, 1.0 - fadeStrength);
+    for (int i = 0; i < m_trailLength; ++i) { float t = (float)i / std::max(1, m_trailLength - 1); m_weights.push_back(fadeStart + t * (1.0f - fadeStart)); }
+    m_ring.assign(m_trailLength, cv::UMat()); m_head = 0; m_count = 0;
+    m_accum.release(); m_scaled.release(); m_out[0].release(); m_out[1].release(); m_cur = 0; m_pending = false;
+    // 彗星模式提前编译两种位深的内核，运行时不支持时在开始渲染前就回退，而不是渲染到一半
+    if (m_valid && m_trailLength > 0) m_valid = ensureKernel(CV_8U) && ensureKernel(CV_16U);
+    return m_valid;
+}
+
+bool OclTrailPipeline::ensureKernel(int depth) {
+    cv::ocl::Kernel &k = kernel(depth);
+    if (!k.empty()) return true;
+    static const cv::ocl::ProgramSource source(kWeightedMaxSource);
+    const char *opts = depth == CV_16U ? "-D T=ushort -D CONVERT=convert_ushort_sat_rte" : "-D T=uchar -D CONVERT=convert_uchar_sat_rte";
+    cv::String err; k.create("weighted_max", source, opts, &err);
+    if (k.empty()) { qDebug() << "OclTrailPipeline: kernel build failed:" << QString::fromStdString(err); m_valid = false; return false; }
+    return true;
+}
+
+void OclTrailPipeline::weightedMax(const cv::UMat &src, float w, cv::UMat &dst, bool init) {
+    if (init) dst.create(src.size(), src.type());
+    int cn = src.channels();
+    size_t globals[2] = { (size_t)src.cols * cn, (size_t)src.rows };
+    cv::ocl::Kernel &k = kernel(src.depth());
+    k.args(cv::ocl::KernelArg::ReadOnlyNoSize(src), cv::ocl::KernelArg::ReadWrite(dst, cn), w, init ? 1 : 0);
+    k.run(2, globals, nullptr, false);
+}
+
+bool OclTrailPipeline::readBack(cv::Mat &ready, cv::MatAllocator *allocator) {
+    if (!m_pending) return false;
+    const cv::UMat &u = m_out[m_cur ^ 1];
+    ready = cv::Mat(); if (allocator) ready.allocator = allocator;
+    ready.create(u.size(), u.type()); u.copyTo(ready);
+    m_pending = false; return true;
+}
+
+bool OclTrailPipeline::push(const cv::Mat &frame, cv::Mat &ready, cv::MatAllocator *allocator) {
+    CV_Assert(m_valid && (frame.depth() == CV_8U || frame.depth() == CV_16U));
+    // 先取回上一帧(只等待上一帧的计算)，再提交本帧，主机与设备交错工作
+    bool have = readBack(ready, allocator);
+
+    const cv::UMat *composite = nullptr;
+    if (m_trailLength == 0) {
+        if (m_accum.empty() || m_accum.size() != frame.size() || m_accum.type() != frame.type()) frame.copyTo(m_accum);
+        else { cv::UMat u; frame.copyTo(u); cv::max(m_accum, u, m_accum); }
+        composite = &m_accum;
+    } else {
+        if (!ensureKernel(frame.depth())) return have; // 本帧未入环，download() 得到的历史截止到上一帧
+        if (m_count > 0 && (m_ring[(m_head + m_trailLength - 1) % m_trailLength].size() != frame.size() || m_ring[(m_head + m_trailLength - 1) % m_trailLength].type() != frame.type())) m_count = 0;
+        frame.copyTo(m_ring[m_head]); m_head = (m_head + 1) % m_trailLength; m_count = std::min(m_count + 1, m_trailLength);
+        // 与 TrailEngine 相同：最旧帧总是加权，其余帧权重 > 0.99 时按 1.0 处理；只有一帧时原样输出
+        // 无需缩放/量化时直接合成到输出缓冲，省一次设备内拷贝
+        cv::UMat &target = (frame.size() == m_outSize && frame.depth() == CV_8U) ? m_out[m_cur] : m_accum;
+        int off = m_trailLength - m_count; int oldest = (m_head + m_trailLength - m_count) % m_trailLength;
+        for (int k = 0; k < m_count; ++k) {
+            float w = m_count == 1 ? 1.0f : m_weights[off + k]; if (k > 0 && w > 0.99f) w = 1.0f;
+            weightedMax(m_ring[(oldest + k) % m_trailLength], w, target, k == 0);
+        }
+        composite = &target;
+    }
+
+    // 缩放与量化也留在设备上，读回的只有编码尺寸的 8 位帧
+    if (composite->size() != m_outSize) { cv::resize(*composite, m_scaled, m_outSize, 0, 0, cv::INTER_AREA); composite = &m_scaled; }
+    if (composite->depth() == CV_16U) composite->convertTo(m_out[m_cur], CV_8U, 255.0/65535.0);
+    else if (composite != &m_out[m_cur]) composite->copyTo(m_out[m_cur]);
+    m_cur ^= 1; m_pending = true;
+    return have;
+}
+
+bool OclTrailPipeline::flush(cv::Mat &ready, cv::MatAllocator *allocator) { return readBack(ready, allocator); }
+
+void OclTrailPipeline::download(std::vector<cv::Mat> &history, cv::Mat &accum, cv::MatAllocator *allocator) const {
+    history.clear(); accum.release();
+    if (m_trailLength == 0) { if (!m_accum.empty()) m_accum.copyTo(accum); return; }
+    int oldest = (m_head + m_trailLength - m_count) % m_trailLength;
+    for (int k = 0; k < m_count; ++k) {
+        const cv::UMat &u = m_ring[(oldest + k) % m_trailLength];
+        cv::Mat m; if (allocator) m.allocator = allocator;
+        m.create(u.size(), u.type()); u.copyTo(m); history.push_back(m);
+    }
+}
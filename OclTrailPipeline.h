@@ -0,0 +1,55 @@
+#ifndef OCLTRAILPIPELINE_H
+#define OCLTRAILPIPELINE_H
+
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+
+// --- OpenCL 合成流水线 ---
+// 拖尾环形缓冲、加权最大值合成、输出缩放与 16 位量化全部在 OpenCL 设备上完成，
+// 每帧只把编码用的 8 位输出读回主机。读回延迟一帧(双缓冲)：push() 先取回上一帧的结果，
+// 再提交本帧的计算后立即返回，设备计算本帧时主机在编码上一帧、解码下一帧。
+// 读回与上传本身是同步拷贝，这两段传输期间设备空闲，不与合成重叠。
+// 合成结果与 TrailEngine / cv::max 的 CPU 路径逐位一致(取整同为就近取偶)。
+class OclTrailPipeline {
+public:
+    OclTrailPipeline();
+    // trailLength <= 0 为无限模式(逐帧 max 累积)；outSize 为编码尺寸
+    bool reset(int trailLength, double fadeStrength, cv::Size outSize);
+    bool isValid() const { return m_valid; }
+
+    // 提交一帧；若上一帧的结果已就绪则写入 ready(分配自 allocator)并返回 true
+    bool push(const cv::Mat &frame, cv::Mat &ready, cv::MatAllocator *allocator = nullptr);
+    // 取回最后一帧的结果
+    bool flush(cv::Mat &ready, cv::MatAllocator *allocator = nullptr);
+    // 中途回退到 CPU 时接续合成状态：彗星模式下载环形缓冲中由旧到新的帧(分配自 allocator)，无限模式下载累加器
+    void download(std::vector<cv::Mat> &history, cv::Mat &accum, cv::MatAllocator *allocator = nullptr) const;
+
+    static bool available();
+
+private:
+    bool ensureKernel(int depth);
+    void weightedMax(const cv::UMat &src, float w, cv::UMat &dst, bool init);
+    cv::ocl::Kernel &kernel(int depth) { return m_kernels[depth == CV_16U ? 1 : 0]; }
+    bool readBack(cv::Mat &ready, cv::MatAllocator *allocator);
+
+    bool m_valid;
+    int m_trailLength;
+    std::vector<float> m_weights;   // 与 TrailEngine 相同的线性权重
+    cv::Size m_outSize;
+
+    std::vector<cv::UMat> m_ring;   // 环形缓冲，m_head 指向下一个写入位置
+    int m_head;
+    int m_count;
+    cv::UMat m_accum;
+    cv::UMat m_scaled;
+    cv::UMat m_out[2];              // 双缓冲的 8 位输出
+    int m_cur;
+    bool m_pending;
+
+    cv::ocl::Kernel m_kernels[2];   // 8 位 / 16 位，reset() 时都编译好
+};
+
+#endif // OCLTRAILPIPELINE_H
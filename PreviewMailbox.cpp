@@ -0,0 +1,77 @@
+#include "PreviewMailbox.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+// ================= PreviewMailbox Implementation =================
+PreviewMailbox::PreviewMailbox(QObject *parent)
+    : QObject(parent), m_notified(false), m_stopping(false), m_target(640, 360), m_worker(nullptr),
+      m_intervalNs(100000000), m_lastPostNs(-1), m_dropped(0)
+{
+    m_clock.start();
+}
+
+PreviewMailbox::~PreviewMailbox() { stop(); }
+
+void PreviewMailbox::start() {
+    stop();
+    { QMutexLocker l(&m_mutex); m_stopping = false; m_slot.release(); m_image = QImage(); m_notified = false; }
+    m_lastPostNs = -1; m_dropped = 0;
+    m_worker = QThread::create([this]() { workerLoop(); }); m_worker->start(QThread::LowPriority);
+}
+
+void PreviewMailbox::stop() {
+    if (!m_worker) return;
+    { QMutexLocker l(&m_mutex); m_stopping = true; m_cond.wakeAll(); }
+    m_worker->wait(); delete m_worker; m_worker = nullptr;
+}
+
+void PreviewMailbox::setTargetSize(QSize size) { if (size.width() < 16 || size.height() < 16) return; QMutexLocker l(&m_mutex); m_target = size; }
+
+void PreviewMailbox::setMaxFps(double fps) { m_intervalNs = fps > 0 ? (qint64)(1e9 / fps) : 0; }
+
+bool PreviewMailbox::post(const cv::Mat &frame, bool shared, bool force) {
+    if (frame.empty() || !m_worker) return false;
+    qint64 now = m_clock.nsecsElapsed(), last = m_lastPostNs.load();
+    if (!force && last >= 0 && now - last < m_intervalNs.load()) return false;
+    m_lastPostNs = now;
+    cv::Mat f = shared ? frame : frame.clone();
+    QMutexLocker l(&m_mutex);
+    if (!m_slot.empty()) m_dropped++; // 预览线程还没处理上一帧：覆盖，不排队
+    m_slot = f; m_cond.wakeOne();
+    return true;
+}
+
+bool PreviewMailbox::take(QImage &image) {
+    QMutexLocker l(&m_mutex);
+    m_notified = false;
+    if (m_image.isNull()) return false;
+    image = m_image; return true;
+}
+
+void PreviewMailbox::workerLoop() {
+    while (true) {
+        cv::Mat frame; QSize target;
+        {
+            QMutexLocker l(&m_mutex);
+            while (m_slot.empty() && !m_stopping) m_cond.wait(&m_mutex);
+            if (m_slot.empty()) return; // 已停止且槽已空
+            frame = m_slot; m_slot.release(); target = m_target;
+        }
+        QImage img = render(frame, target); frame.release();
+        bool notify = false;
+        { QMutexLocker l(&m_mutex); m_image = img; if (!m_notified) { m_notified = true; notify = true; } }
+        if (notify) emit previewReady();
+    }
+}
+
+// 等比缩放到目标框内 (INTER_AREA)，16 位在缩小后再量化，BGR->RGB 直接写进 QImage 的缓冲
+QImage PreviewMailbox::render(const cv::Mat &frame, QSize target) const {
+    double s = std::min((double)target.width() / frame.cols, (double)target.height() / frame.rows);
+    cv::Size sz(std::max(1, (int)(frame.cols * s)), std::max(1, (int)(frame.rows * s)));
+    cv::Mat small; if (sz != frame.size()) cv::resize(frame, small, sz, 0, 0, s < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR); else small = frame;
+    if (small.depth() == CV_16U) small.convertTo(small, CV_8U, 255.0/65535.0);
+    QImage img(small.cols, small.rows, QImage::Format_RGB888);
+    cv::Mat dst(small.rows, small.cols, CV_8UC3, img.bits(), img.bytesPerLine());
+    cv::cvtColor(small, dst, small.channels() == 1 ? cv::COLOR_GRAY2RGB : cv::COLOR_BGR2RGB);
+    return img;
+}
@@ -0,0 +1,60 @@
+#ifndef PREVIEWMAILBOX_H
+#define PREVIEWMAILBOX_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QSize>
+#include <QElapsedTimer>
+#include <atomic>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 渲染预览信箱 ---
+// 单槽“最新帧优先”：渲染线程按时间间隔投递，间隔未到的帧直接丢弃；槽中尚未处理的旧帧被新帧覆盖。
+// 预览线程把帧直接缩放到目标尺寸(界面标签大小)并转成 QImage；界面尚未取走上一张时不再发通知，
+// 事件循环里最多只有一个待处理的 previewReady，刷新率与渲染速度无关。
+class PreviewMailbox : public QObject {
+    Q_OBJECT
+public:
+    explicit PreviewMailbox(QObject *parent = nullptr);
+    ~PreviewMailbox();
+
+    void start();
+    // 处理完槽中最后一帧后退出
+    void stop();
+    void setTargetSize(QSize size);
+    void setMaxFps(double fps);
+
+    // 渲染线程调用；shared 表示调用方之后不会修改 frame(否则在这里拷贝)。force 忽略时间间隔(最后一帧)
+    bool post(const cv::Mat &frame, bool shared, bool force = false);
+    // GUI 线程调用：取走最新的预览图
+    bool take(QImage &image);
+    qint64 droppedCount() const { return m_dropped.load(); }
+
+signals:
+    void previewReady();
+
+private:
+    void workerLoop();
+    QImage render(const cv::Mat &frame, QSize target) const;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    cv::Mat m_slot;
+    QImage m_image;
+    bool m_notified;
+    bool m_stopping;
+    QSize m_target;
+    QThread *m_worker;
+
+    QElapsedTimer m_clock;
+    std::atomic<qint64> m_intervalNs;
+    std::atomic<qint64> m_lastPostNs;
+    std::atomic<qint64> m_dropped;
+};
+
+#endif // PREVIEWMAILBOX_H
@@ -0,0 +1,155 @@
+#include "ProxyCache.h"
+#include "MainWindow.h"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QFile>
+#include <QSaveFile>
+#include <QImageReader>
+#include <QDir>
+#include <QDateTime>
+#include <QDebug>
+
+// ================= ProxyCache Implementation =================
+ProxyCache::ProxyCache(const QString &sourcePath, const QStringList &files, int total, int w, int h, int proxyHeight, QObject *parent)
+    : QObject(parent), m_source(sourcePath), m_files(files), m_total(std::max(0, total)), m_w(w), m_h(h),
+      m_diskWritable(false), m_orderPos(0), m_ready(0), m_stopping(false)
+{
+    m_proxyH = std::max(16, std::min(proxyHeight, h > 0 ? h : proxyHeight));
+    m_proxyW = std::max(16, h > 0 ? (int)((long long)w * m_proxyH / h) : m_proxyH);
+    m_jpeg.resize(m_total); m_scheduled.assign(m_total, 0);
+
+    // 缓存目录由素材路径、每个文件的大小与修改时间和代理尺寸决定，序列中任一帧变化后自动失效
+    QFileInfo src(sourcePath);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QStringList keyFiles = m_files.isEmpty() ? QStringList{sourcePath} : m_files;
+    for (const QString &f : keyFiles) {
+        QFileInfo fi(f); hash.addData(fi.fileName().toUtf8());
+        hash.addData(QByteArray::number(fi.size())); hash.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    }
+    hash.addData(QByteArray::number(m_total)); hash.addData(QByteArray::number(m_proxyH));
+    m_cacheDir = src.dir().filePath(".startrails_proxy/" + src.completeBaseName() + "_" + hash.result().toHex().left(12));
+    m_diskWritable = QDir().mkpath(m_cacheDir);
+
+    // 由粗到细：先每隔 2^k 帧取一帧，再逐级加密，时间轴很快就有全程的粗略预览
+    std::vector<char> added(m_total, 0); int stride = 1; while (stride * 2 < m_total) stride *= 2;
+    for (; stride >= 1; stride /= 2) for (int i = 0; i < m_total; i += stride) if (!added[i]) { added[i] = 1; m_order << i; }
+}
+
+ProxyCache::~ProxyCache() {
+    { QMutexLocker l(&m_mutex); m_stopping = true; m_urgentCond.wakeAll(); }
+    for (QThread *t : m_workers) { t->wait(); delete t; }
+}
+
+void ProxyCache::start() {
+    if (!m_workers.isEmpty() || m_total == 0) return;
+    int n = m_files.isEmpty() ? 1 : std::max(1, QThread::idealThreadCount() / 2);
+    for (int i = 0; i < n; ++i) {
+        QThread *t = m_files.isEmpty() ? QThread::create([this]() { videoWorker(); }) : QThread::create([this]() { sequenceWorker(); });
+        m_workers.append(t); t->start(QThread::LowPriority);
+    }
+}
+
+bool ProxyCache::thumbnail(int index, QImage &image, bool *exact) {
+    if (index < 0 || index >= m_total) return false;
+    while (true) {
+        QByteArray jpg; int found = -1;
+        {
+            QMutexLocker l(&m_mutex);
+            for (int d = 0; d < m_total && found < 0; ++d) {
+                if (index - d >= 0 && !m_jpeg[index - d].isEmpty()) found = index - d;
+                else if (index + d < m_total && !m_jpeg[index + d].isEmpty()) found = index + d;
+                else if (index - d < 0 && index + d >= m_total) break;
+            }
+            if (found >= 0) jpg = m_jpeg[found];
+        }
+        if (found < 0) return false;
+        if (image.loadFromData(jpg, "JPG")) { if (exact) *exact = (found == index); return true; }
+        static const bool canDecode = QImageReader::supportedImageFormats().contains("jpg");
+        if (!canDecode) return false; // 缺少 JPEG 插件时不是代理的问题
+        // 解不开的代理(磁盘文件损坏)按缺失处理：删掉、重新生成，这次改用其他最近帧
+        QFile::remove(proxyPath(found));
+        { QMutexLocker l(&m_mutex); if (m_jpeg[found] == jpg) { m_jpeg[found].clear(); m_ready--; m_scheduled[found] = 0; } }
+        request(found);
+    }
+}
+
+void ProxyCache::request(int index) {
+    if (index < 0 || index >= m_total) return;
+    QMutexLocker l(&m_mutex);
+    if (!m_jpeg[index].isEmpty() || m_urgent.contains(index)) return;
+    m_urgent.prepend(index); if (m_urgent.size() > 8) m_urgent.removeLast(); // 只保留最近的几次请求
+    m_urgentCond.wakeAll();
+}
+
+int ProxyCache::readyCount() { QMutexLocker l(&m_mutex); return m_ready; }
+
+QString ProxyCache::proxyPath(int index) const { return m_cacheDir + QString("/%1.jpg").arg(index, 6, 10, QChar('0')); }
+
+// 插队请求优先，其次按由粗到细的顺序
+bool ProxyCache::takeNext(int &index) {
+    QMutexLocker l(&m_mutex);
+    while (!m_stopping) {
+        while (!m_urgent.isEmpty()) { int u = m_urgent.takeFirst(); if (!m_scheduled[u]) { m_scheduled[u] = 1; index = u; return true; } }
+        while (m_orderPos < m_order.size()) { int o = m_order[m_orderPos++]; if (!m_scheduled[o]) { m_scheduled[o] = 1; index = o; return true; } }
+        m_urgentCond.wait(&m_mutex); // 全部生成完毕，只剩插队请求(已就绪)可能到来
+    }
+    return false;
+}
+
+bool ProxyCache::loadFromDisk(int index) {
+    QFile f(proxyPath(index));
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QByteArray jpg = f.readAll();
+    // 缺少 SOI/EOI 标记的是写到一半的文件，当作缺失重新生成
+    if (jpg.size() < 4 || !jpg.startsWith("\xFF\xD8") || !jpg.endsWith("\xFF\xD9")) { f.close(); f.remove(); return false; }
+    store(index, jpg); return true;
+}
+
+void ProxyCache::buildFrom(int index, const cv::Mat &frame) {
+    if (frame.empty()) return;
+    cv::Mat small; cv::resize(frame, small, cv::Size(m_proxyW, m_proxyH), 0, 0, cv::INTER_AREA);
+    std::vector<uchar> buf; cv::imencode(".jpg", small, buf, {cv::IMWRITE_JPEG_QUALITY, 85});
+    QByteArray jpg((const char*)buf.data(), (int)buf.size());
+    // QSaveFile 先写临时文件再改名，中途崩溃或退出不会留下截断的代理
+    if (m_diskWritable) { QSaveFile f(proxyPath(index)); if (f.open(QIODevice::WriteOnly)) { f.write(jpg); f.commit(); } }
+    store(index, jpg);
+}
+
+void ProxyCache::store(int index, const QByteArray &jpg) {
+    {
+        QMutexLocker l(&m_mutex);
+        if (m_jpeg[index].isEmpty()) m_ready++;
+        m_jpeg[index] = jpg; m_scheduled[index] = 1;
+    }
+    emit proxyReady(index);
+}
+
+void ProxyCache::sequenceWorker() {
+    int idx;
+    while (takeNext(idx)) {
+        if (loadFromDisk(idx)) continue;
+        cv::Mat img; if (FrameProvider::decodeSequenceFrame(m_files[idx], m_w, m_h, img)) buildFrom(idx, img);
+    }
+}
+
+// 视频只能顺序解码：先读磁盘缓存，再顺序解码缺失的帧；插队请求通过关键帧索引定位单独解码后回到原位置
+void ProxyCache::videoWorker() {
+    for (int i = 0; i < m_total; ++i) { { QMutexLocker l(&m_mutex); if (m_stopping) return; } loadFromDisk(i); }
+    VideoFrameReader reader(m_source); if (!reader.isOpened()) return;
+    int pos = 0; cv::Mat frame;
+    while (true) {
+        int urgent = -1; bool done;
+        {
+            QMutexLocker l(&m_mutex);
+            if (m_stopping) return;
+            while (!m_urgent.isEmpty() && urgent < 0) { int u = m_urgent.takeFirst(); if (m_jpeg[u].isEmpty()) urgent = u; }
+            while (pos < m_total && !m_jpeg[pos].isEmpty()) pos++;
+            done = pos >= m_total;
+            if (done && urgent < 0) { m_urgentCond.wait(&m_mutex); continue; }
+        }
+        if (urgent >= 0) { if (reader.seek(urgent) && reader.read(frame)) buildFrom(urgent, frame); continue; }
+        reader.seek(pos); // 插队解码后回到顺序位置；已在该位置时不做任何事
+        if (!reader.read(frame)) break; // 帧数元数据偏大时，之后的帧用最近的已生成帧占位
+        buildFrom(pos, frame); pos++;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PROXYCACHE_H
+#define PROXYCACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 时间轴代理缓存 ---
+// 后台线程为整个素材生成低分辨率缩略图(JPEG)，内存中保存压缩数据，同时写入素材旁的
+// .startrails_proxy 目录，下次打开同一素材时直接读取。拖动时间轴只查内存，不做全尺寸解码。
+// 序列按“由粗到细”的顺序生成，尚未生成的帧先用最近的已生成帧占位；request() 可让某帧插队。
+class ProxyCache : public QObject {
+    Q_OBJECT
+public:
+    // files 为空时按视频处理 sourcePath；w/h 为原始尺寸
+    ProxyCache(const QString &sourcePath, const QStringList &files, int total, int w, int h, int proxyHeight = 240, QObject *parent = nullptr);
+    ~ProxyCache();
+
+    void start();
+    // 取第 index 帧的缩略图；该帧未就绪时返回最近的已就绪帧，exact 指示是否精确命中
+    bool thumbnail(int index, QImage &image, bool *exact = nullptr);
+    // 让第 index 帧优先生成
+    void request(int index);
+    int readyCount();
+    int total() const { return m_total; }
+    QString cacheDir() const { return m_cacheDir; }
+
+signals:
+    void proxyReady(int index);
+
+private:
+    void sequenceWorker();
+    void videoWorker();
+    bool takeNext(int &index);
+    bool loadFromDisk(int index);
+    void buildFrom(int index, const cv::Mat &frame);
+    void store(int index, const QByteArray &jpg);
+    QString proxyPath(int index) const;
+
+    QString m_source;
+    QStringList m_files;
+    int m_total;
+    int m_w, m_h;
+    int m_proxyW, m_proxyH;
+    QString m_cacheDir;
+    bool m_diskWritable;
+
+    QList<QThread*> m_workers;
+    QMutex m_mutex;
+    QWaitCondition m_urgentCond;
+    std::vector<QByteArray> m_jpeg;   // 每帧的 JPEG 数据，空 = 未就绪
+    std::vector<char> m_scheduled;
+    QList<int> m_order;               // 生成顺序
+    QList<int> m_urgent;              // 插队请求
+    int m_orderPos;
+    int m_ready;
+    bool m_stopping;
+};
+
+#endif // PROXYCACHE_H
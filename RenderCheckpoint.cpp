@@ -0,0 +1,94 @@
+#include "RenderCheckpoint.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QDebug>
+#include <cstring>
+
+// 累加器文件 accumNNNN.bin：魔数 + rows/cols/type (int32) + 连续像素数据
+static const char kAccumMagic[8] = {'S', 'T', 'A', 'C', 'C', '0', '0', '1'};
+
+// ================= RenderCheckpoint Implementation =================
+RenderCheckpoint::RenderCheckpoint(const QString &outPath, const QJsonObject &fingerprint)
+    : m_fingerprint(fingerprint), m_committed(0), m_parts(0), m_saver(nullptr)
+{
+    m_dir = outPath + ".ckpt"; m_suffix = QFileInfo(outPath).suffix();
+}
+
+RenderCheckpoint::~RenderCheckpoint() { wait(); }
+
+QString RenderCheckpoint::partPath(int index) const { return m_dir + QString("/part%1.%2").arg(index, 4, 10, QChar('0')).arg(m_suffix); }
+
+QStringList RenderCheckpoint::partPaths(int count) const { QStringList l; for (int i = 0; i < count; ++i) l << partPath(i); return l; }
+
+bool RenderCheckpoint::load() {
+    m_committed = 0; m_parts = 0; m_accumFile.clear();
+    QFile f(m_dir + "/manifest.json");
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QJsonObject m = QJsonDocument::fromJson(f.readAll()).object();
+    if (m.value("fingerprint").toObject() != m_fingerprint) { qDebug() << "RenderCheckpoint: 参数已变化，忽略旧检查点" << m_dir; return false; }
+    int committed = m.value("committed").toInt(), parts = m.value("parts").toInt();
+    if (committed <= 0 || parts <= 0) return false;
+    m_accumFile = m.value("accum").toString();
+    for (int i = 0; i < parts; ++i) if (QFileInfo(partPath(i)).size() <= 0) { qDebug() << "RenderCheckpoint: 分段缺失" << partPath(i); return false; }
+    m_committed = committed; m_parts = parts; return true;
+}
+
+void RenderCheckpoint::clear() {
+    wait(); QDir(m_dir).removeRecursively(); QDir().mkpath(m_dir);
+    m_committed = 0; m_parts = 0; m_accumFile.clear();
+}
+
+void RenderCheckpoint::remove() { wait(); QDir(m_dir).removeRecursively(); }
+
+bool RenderCheckpoint::loadAccum(cv::Mat &accum) const {
+    if (m_accumFile.isEmpty()) return false;
+    QFile f(m_dir + "/" + m_accumFile);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    char magic[8]; qint32 hdr[3];
+    if (f.read(magic, 8) != 8 || memcmp(magic, kAccumMagic, 8) != 0 || f.read((char*)hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    if (hdr[0] <= 0 || hdr[1] <= 0) return false;
+    accum.create(hdr[0], hdr[1], hdr[2]);
+    qint64 bytes = (qint64)accum.total() * accum.elemSize();
+    return f.read((char*)accum.data, bytes) == bytes;
+}
+
+bool RenderCheckpoint::busy() const { return m_saver && !m_saver->isFinished(); }
+
+void RenderCheckpoint::wait() { if (m_saver) { m_saver->wait(); delete m_saver; m_saver = nullptr; } }
+
+bool RenderCheckpoint::saveAsync(std::function<bool()> finalize, int partIndex, int committedFrames, const cv::Mat &accum) {
+    if (busy()) return false;
+    wait();
+    cv::Mat snapshot = accum; // 调用方传入的是已克隆的快照
+    m_saver = QThread::create([this, finalize, partIndex, committedFrames, snapshot]() { if (finalize()) save(partIndex, committedFrames, snapshot); });
+    m_saver->start(QThread::LowPriority);
+    return true;
+}
+
+// 先写本次的累加器文件，最后原子替换清单：中途崩溃时旧清单及其引用的文件仍然有效，
+// 未列入清单的分段在恢复时被覆盖
+void RenderCheckpoint::save(int partIndex, int committedFrames, const cv::Mat &accum) {
+    if (QFileInfo(partPath(partIndex)).size() <= 0) { qDebug() << "RenderCheckpoint: 分段未写出，跳过检查点" << partPath(partIndex); return; }
+    QString accumFile = accum.empty() ? QString() : QString("accum%1.bin").arg(partIndex, 4, 10, QChar('0'));
+    if (!accum.empty()) {
+        QSaveFile f(m_dir + "/" + accumFile);
+        cv::Mat c = accum.isContinuous() ? accum : accum.clone(); qint32 hdr[3] = { c.rows, c.cols, c.type() };
+        if (!f.open(QIODevice::WriteOnly)) { qDebug() << "RenderCheckpoint: 无法写入累加器"; return; }
+        f.write(kAccumMagic, 8); f.write((const char*)hdr, sizeof(hdr)); f.write((const char*)c.data, (qint64)c.total() * c.elemSize());
+        if (!f.commit()) { qDebug() << "RenderCheckpoint: 累加器写入失败"; return; }
+    }
+    QJsonObject m; m["version"] = 1; m["fingerprint"] = m_fingerprint; m["committed"] = committedFrames; m["parts"] = partIndex + 1;
+    if (!accumFile.isEmpty()) m["accum"] = accumFile;
+    QSaveFile f(m_dir + "/manifest.json");
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(m).toJson());
+        if (f.commit()) {
+            if (!m_accumFile.isEmpty() && m_accumFile != accumFile) QFile::remove(m_dir + "/" + m_accumFile);
+            m_accumFile = accumFile; m_committed = committedFrames; m_parts = partIndex + 1; return;
+        }
+    }
+    qDebug() << "RenderCheckpoint: 清单写入失败";
+}
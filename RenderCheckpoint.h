@@ -0,0 +1,56 @@
+#ifndef RENDERCHECKPOINT_H
+#define RENDERCHECKPOINT_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QThread>
+#include <functional>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 渲染检查点 ---
+// 输出按检查点切成分段文件(<输出>.ckpt/partNNNN.<后缀>)，每个检查点关闭当前分段，使其成为完整可播放的文件，
+// 并记录已提交的输出帧数；无限模式另存累加器原始数据。渲染结束后由调用方拼接分段。
+// 彗星模式不保存拖尾历史(可能达数十 GB)：恢复时从检查点前 trailLength-1 帧开始预热，输出与不间断渲染逐位一致。
+// 保存在后台线程完成(等待旧分段编码完毕、写累加器、原子替换清单)，渲染循环不等待磁盘。
+class RenderCheckpoint {
+public:
+    // fingerprint 描述影响输出的全部参数，与已有清单不一致时视为新任务
+    RenderCheckpoint(const QString &outPath, const QJsonObject &fingerprint);
+    ~RenderCheckpoint();
+
+    // 读取匹配的检查点；失败时返回 false 且状态为空
+    bool load();
+    // 删除已有检查点，从头开始
+    void clear();
+    // 渲染完成后删除整个检查点目录
+    void remove();
+
+    // 以下状态由后台保存更新，只在 wait() 之后读取
+    int committedFrames() const { return m_committed; }
+    int partCount() const { return m_parts; }
+    QString partPath(int index) const;
+    QStringList partPaths(int count) const;
+    bool loadAccum(cv::Mat &accum) const;
+
+    // 后台保存：finalize 关闭第 partIndex 个分段(阻塞到编码完成)，返回 true 时再写入累加器(可为空)与清单；
+    // 返回 false(分段编码失败)时不更新检查点。上一次保存尚未完成时返回 false，调用方稍后重试
+    bool saveAsync(std::function<bool()> finalize, int partIndex, int committedFrames, const cv::Mat &accum);
+    bool busy() const;
+    void wait();
+
+private:
+    void save(int partIndex, int committedFrames, const cv::Mat &accum);
+
+    QString m_dir;
+    QString m_suffix;
+    QJsonObject m_fingerprint;
+    QString m_accumFile;    // 清单引用的累加器文件，每个检查点一个，提交后删除旧文件
+    int m_committed;
+    int m_parts;
+    QThread *m_saver;
+};
+
+#endif // RENDERCHECKPOINT_H
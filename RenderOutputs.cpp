@@ -0,0 +1,66 @@
+#include "RenderOutputs.h"
+#include "MainWindow.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+// ================= OutputTarget Implementation =================
+QString OutputTarget::resolvedPath(const QString &mainPath) const {
+    if (!path.isEmpty()) return path;
+    QFileInfo m(mainPath);
+    return m.dir().filePath(m.completeBaseName() + "_" + (tag.isEmpty() ? QString("alt") : tag) + format);
+}
+
+QString livePhotoVideoPath(const QString &mainPath, const QList<OutputTarget> &targets) {
+    for (const OutputTarget &t : targets) if (t.livePhoto) return t.resolvedPath(mainPath);
+    return mainPath;
+}
+
+// ================= OutputFanout Implementation =================
+OutputFanout::OutputFanout(const QList<OutputTarget> &targets, const QString &mainPath, cv::Size mainSize, double mainFps, int count, int queueCapacity, FramePool *pool, RenderTrace *trace)
+    : m_queueCapacity(std::max(1, queueCapacity))
+{
+    for (const OutputTarget &t : targets) {
+        Output o; o.path = t.resolvedPath(mainPath);
+        o.begin = t.startFrame < 0 ? std::max(0, count + t.startFrame) : std::min(t.startFrame, count);
+        o.end = (t.endFrame < 0 || t.endFrame > count) ? count : t.endFrame;
+        if (o.end <= o.begin) { qDebug() << "附加输出帧范围为空，跳过:" << o.path; continue; }
+        // 只缩小不放大：宽度按主输出宽高比；与主输出一样向下取偶数，yuv420p 的 H.264/HEVC 不接受奇数尺寸
+        int h = (t.height <= 0 || t.height > mainSize.height) ? mainSize.height : t.height;
+        int w = (int)std::lround((double)mainSize.width * h / mainSize.height);
+        w = std::max(2, w - w % 2); h = std::max(2, h - h % 2);
+        double fps = t.fps > 0 ? t.fps : mainFps;
+        o.step = mainFps / fps; o.next = 0; o.total = (long long)std::ceil((o.end - o.begin) / o.step - 1e-9);
+        o.writer = new VideoWriterWorker(o.path, w, h, fps, t.isMov(), m_queueCapacity);
+        o.writer->setFramePool(pool); o.writer->setTrace(trace); o.writer->setEncoder(t.encoder); o.writer->start();
+        qDebug() << "Extra output:" << o.path << w << "x" << h << "@" << fps << "frames" << o.begin << "-" << o.end;
+        m_outputs.push_back(o);
+    }
+}
+
+OutputFanout::~OutputFanout() { QString error; finish(error); }
+
+int OutputFanout::heldFrames() const { return (int)m_outputs.size() * m_queueCapacity; }
+
+// 第 k 个目标帧取主输出的第 begin + floor(k * step) 帧：帧率较低时均匀抽帧，较高时重复帧，时长不变
+void OutputFanout::push(int idx, const cv::Mat &frame) {
+    for (Output &o : m_outputs) {
+        if (idx < o.begin || idx >= o.end) continue;
+        while (o.next < o.total && o.begin + (long long)std::floor(o.next * o.step + 1e-9) <= idx) { o.writer->addSharedFrame(frame); o.next++; }
+    }
+}
+
+bool OutputFanout::finish(QString &error) {
+    for (Output &o : m_outputs) {
+        if (!o.writer) continue;
+        o.writer->stop(); WriterQueueStats s = o.writer->stats();
+        qDebug() << "Extra output done:" << o.path << s.framesWritten << "frames";
+        if (s.failed() && error.isEmpty()) error = QString("附加输出 %1 %2").arg(o.path).arg(s.error);
+        delete o.writer; o.writer = nullptr;
+    }
+    return error.isEmpty();
+}
+
+QStringList OutputFanout::paths() const { QStringList p; for (const Output &o : m_outputs) p << o.path; return p; }
@@ -0,0 +1,68 @@
+#ifndef RENDEROUTPUTS_H
+#define RENDEROUTPUTS_H
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+#include "VideoEncoder.h"
+
+class FramePool;
+class RenderTrace;
+class VideoWriterWorker;
+
+// --- 附加输出 ---
+// 与主输出共用一次解码与合成的额外视频(社交版本、实况短片等)。分辨率、帧率、帧范围、容器各自独立，
+// 帧范围以主输出的帧序号计(0 = 渲染起点)。
+struct OutputTarget {
+    QString path;             // 空 = 主输出路径加 "_<tag>" 后缀
+    QString tag;
+    QString format = ".mp4";  // 容器，path 非空时以 path 后缀为准
+    int height = 0;           // 0 = 与主输出相同，不超过主输出
+    double fps = 0;           // 0 = 与主输出相同；较低时按时间抽帧，较高时重复帧
+    int startFrame = 0;       // 负数 = 从结尾倒数
+    int endFrame = -1;        // -1 = 到结尾
+    bool livePhoto = false;   // 作为实况照片内嵌的视频，封装后删除
+    EncoderSettings encoder;
+
+    QString resolvedPath(const QString &mainPath) const;
+    bool isMov() const { return (path.isEmpty() ? format : path).endsWith(".mov", Qt::CaseInsensitive); }
+};
+
+// 实况照片应内嵌的视频：有 livePhoto 附加输出时用它，否则用主输出
+QString livePhotoVideoPath(const QString &mainPath, const QList<OutputTarget> &targets);
+
+// --- 附加输出分发 ---
+// 每个目标一个 VideoWriterWorker(各自的编码线程负责缩放与量化)，渲染线程只把同一帧的引用分发出去
+class OutputFanout {
+public:
+    // mainSize/mainFps/count 为主输出的尺寸、帧率与帧数
+    OutputFanout(const QList<OutputTarget> &targets, const QString &mainPath, cv::Size mainSize, double mainFps, int count, int queueCapacity, FramePool *pool, RenderTrace *trace);
+    ~OutputFanout();
+    bool isEmpty() const { return m_outputs.empty(); }
+    // 附加输出最多同时持有的帧数，用于帧池容量
+    int heldFrames() const;
+    // 主输出第 idx 帧，按顺序调用；frame 之后不会再被修改
+    void push(int idx, const cv::Mat &frame);
+    // 等待全部编码结束；任一附加输出编码失败时返回 false，error 为第一个失败原因
+    bool finish(QString &error);
+    QStringList paths() const;
+
+private:
+    struct Output {
+        QString path;
+        VideoWriterWorker *writer;
+        int begin, end;       // 主输出帧范围 [begin, end)
+        double step;          // 每个目标帧对应的主输出帧数
+        long long next;       // 下一个目标帧
+        long long total;
+    };
+    std::vector<Output> m_outputs;
+    int m_queueCapacity;
+};
+
+#endif // RENDEROUTPUTS_H
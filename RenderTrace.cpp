@@ -0,0 +1,133 @@
+#include "RenderTrace.h"
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+
+// 进程内唯一的小整数线程号，trace 中用作 tid
+static int currentTid() {
+    static std::atomic<int> next(1);
+    thread_local int tid = next.fetch_add(1);
+    return tid;
+}
+
+// ================= RenderStats Implementation =================
+const char *RenderStats::stageName(RenderStage s) {
+    switch (s) {
+    case RenderStage::Read: return "read";
+    case RenderStage::Decode: return "decode";
+    case RenderStage::Crop: return "crop";
+    case RenderStage::Composite: return "composite";
+    case RenderStage::Preview: return "preview";
+    case RenderStage::Enqueue: return "enqueue";
+    case RenderStage::Encode: return "encode";
+    default: return "?";
+    }
+}
+
+QString RenderStats::bottleneck() const {
+    double wait = (*this)[RenderStage::Read].totalMs, stall = (*this)[RenderStage::Enqueue].totalMs;
+    double work = (*this)[RenderStage::Crop].totalMs + (*this)[RenderStage::Composite].totalMs + (*this)[RenderStage::Preview].totalMs;
+    if (wait <= 0 && stall <= 0 && work <= 0) return QString();
+    if (wait >= stall && wait >= work) return "解码";
+    return stall >= work ? "编码" : "合成";
+}
+
+QString RenderStats::summary() const {
+    QStringList parts;
+    for (int i = 0; i < (int)RenderStage::Count; ++i) if (stages[i].count) parts << QString("%1 %2").arg(stageName((RenderStage)i)).arg(stages[i].avgMs(), 0, 'f', 1);
+    QString b = bottleneck();
+    QString skip = blocks ? QString("  跳块 %1%").arg(skipRatio() * 100.0, 0, 'f', 1) : QString();
+    return parts.join(" | ") + " ms" + skip + (b.isEmpty() ? QString() : QString("  瓶颈: %1").arg(b));
+}
+
+QString RenderStats::resourceSummary() const {
+    QStringList parts;
+    if (compositeThreads) parts << QString("合成 %1 线程%2 块 %3 元素").arg(compositeThreads).arg(segments > 1 ? QString(" x %1 段").arg(segments) : QString()).arg(tileElems);
+    if (poolCapacity) parts << QString("帧池 容量 %1 分配 %2 复用 %3 溢出 %4").arg(poolCapacity).arg(poolAllocated).arg(poolReused).arg(poolOverflow);
+    if (queueCapacity) parts << QString("写入队列 容量 %1 最大深度 %2 生产者阻塞 %3 ms 消费者空等 %4 ms").arg(queueCapacity).arg(queueMaxDepth).arg(producerStallMs, 0, 'f', 1).arg(consumerIdleMs, 0, 'f', 1);
+    return parts.join(" | ");
+}
+
+QJsonObject RenderStats::toJson() const {
+    QJsonObject o;
+    for (int i = 0; i < (int)RenderStage::Count; ++i) {
+        QJsonObject s; s["count"] = (double)stages[i].count; s["totalMs"] = stages[i].totalMs; s["avgMs"] = stages[i].avgMs(); s["maxMs"] = stages[i].maxMs;
+        o[stageName((RenderStage)i)] = s;
+    }
+    o["wallMs"] = wallMs; o["bottleneck"] = bottleneck();
+    o["blocks"] = (double)blocks; o["skippedBlocks"] = (double)skippedBlocks; o["skipRatio"] = skipRatio();
+    QJsonObject pool; pool["capacity"] = (double)poolCapacity; pool["allocated"] = (double)poolAllocated; pool["reused"] = (double)poolReused; pool["overflow"] = (double)poolOverflow;
+    o["framePool"] = pool;
+    QJsonObject queue; queue["capacity"] = queueCapacity; queue["maxDepth"] = queueMaxDepth; queue["producerStallMs"] = producerStallMs; queue["consumerIdleMs"] = consumerIdleMs;
+    o["writerQueue"] = queue;
+    QJsonObject comp; comp["threads"] = compositeThreads; comp["segments"] = segments; comp["tileElems"] = (double)tileElems;
+    o["composite"] = comp;
+    return o;
+}
+
+// ================= RenderTrace Implementation =================
+RenderTrace::RenderTrace() : m_origin(std::chrono::steady_clock::now()), m_events(false) {}
+
+void RenderTrace::reset(bool events) {
+    QMutexLocker l(&m_mutex);
+    m_origin = std::chrono::steady_clock::now(); m_events = events;
+    m_stats = RenderStats(); m_log.clear(); m_threadNames.clear();
+}
+
+qint64 RenderTrace::nowNs() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count(); }
+
+void RenderTrace::record(RenderStage stage, qint64 startNs, qint64 endNs) {
+    double ms = (endNs - startNs) / 1e6; int tid = m_events ? currentTid() : 0;
+    QMutexLocker l(&m_mutex);
+    StageStat &s = m_stats.stages[(int)stage]; s.count++; s.totalMs += ms; if (ms > s.maxMs) s.maxMs = ms;
+    if (m_events) m_log.push_back({startNs, endNs, tid, stage});
+}
+
+void RenderTrace::addBlocks(qint64 total, qint64 skipped) {
+    QMutexLocker l(&m_mutex); m_stats.blocks += total; m_stats.skippedBlocks += skipped;
+}
+
+void RenderTrace::addFramePool(qint64 capacity, qint64 allocated, qint64 reused, qint64 overflow) {
+    QMutexLocker l(&m_mutex); m_stats.poolCapacity += capacity; m_stats.poolAllocated += allocated; m_stats.poolReused += reused; m_stats.poolOverflow += overflow;
+}
+
+void RenderTrace::addWriterQueue(int capacity, int maxDepth, double producerStallMs, double consumerIdleMs) {
+    QMutexLocker l(&m_mutex); m_stats.queueCapacity = std::max(m_stats.queueCapacity, capacity); m_stats.queueMaxDepth = std::max(m_stats.queueMaxDepth, maxDepth);
+    m_stats.producerStallMs += producerStallMs; m_stats.consumerIdleMs += consumerIdleMs;
+}
+
+void RenderTrace::setComposite(int threads, qint64 tileElems) { QMutexLocker l(&m_mutex); m_stats.compositeThreads = threads; m_stats.tileElems = tileElems; }
+void RenderTrace::setSegments(int segments) { QMutexLocker l(&m_mutex); m_stats.segments = segments; }
+
+void RenderTrace::nameThread(const QString &name) {
+    int tid = currentTid();
+    QMutexLocker l(&m_mutex); m_threadNames[tid] = name;
+}
+
+RenderStats RenderTrace::snapshot() const {
+    qint64 now = nowNs();
+    QMutexLocker l(&m_mutex); RenderStats s = m_stats; s.wallMs = now / 1e6; return s;
+}
+
+// Chrome trace event 格式：每次调用一个 "X" 完整事件(微秒)，线程名用 "M" 元数据事件
+bool RenderTrace::exportChrome(const QString &path) const {
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
+    QTextStream out(&f);
+    QMutexLocker l(&m_mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto it = m_threadNames.constBegin(); it != m_threadNames.constEnd(); ++it) {
+        out << (first ? "" : ",\n") << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}").arg(it.key()).arg(it.value());
+        first = false;
+    }
+    for (const Event &e : m_log) {
+        out << (first ? "" : ",\n") << QString("{\"name\":\"%1\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4}")
+               .arg(RenderStats::stageName(e.stage)).arg(e.tid).arg(e.startNs / 1000.0, 0, 'f', 3).arg((e.endNs - e.startNs) / 1000.0, 0, 'f', 3);
+        first = false;
+    }
+    out << "\n]}\n";
+    return out.status() == QTextStream::Ok;
+}
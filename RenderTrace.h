@@ -0,0 +1,93 @@
+#ifndef RENDERTRACE_H
+#define RENDERTRACE_H
+
+#include <QString>
+#include <QMetaType>
+#include <QJsonObject>
+#include <QMutex>
+#include <QHash>
+#include <vector>
+#include <chrono>
+
+// --- 渲染阶段计时 ---
+// 各阶段的调用次数/总耗时/最大耗时随时可取快照(RenderStats)，供界面与命令行显示；
+// 开启事件记录时同时保存每次调用的起止时间，渲染结束后导出为 Chrome/Perfetto 可打开的 trace JSON。
+// Read 与 Enqueue 是渲染线程的等待时间：前者长说明解码跟不上，后者长说明编码跟不上。
+enum class RenderStage { Read, Decode, Crop, Composite, Preview, Enqueue, Encode, Count };
+
+struct StageStat {
+    qint64 count = 0;
+    double totalMs = 0;
+    double maxMs = 0;
+    double avgMs() const { return count ? totalMs / count : 0.0; }
+};
+
+struct RenderStats {
+    StageStat stages[(int)RenderStage::Count];
+    double wallMs = 0;
+    qint64 blocks = 0;          // 无限模式参与跳块判断的块数
+    qint64 skippedBlocks = 0;   // 其中整块跳过的块数
+    double skipRatio() const { return blocks ? (double)skippedBlocks / blocks : 0.0; }
+    // 帧池：容量/实际分配的缓冲数/复用次数/超出容量的堆分配次数 (分段渲染为各段之和)
+    qint64 poolCapacity = 0, poolAllocated = 0, poolReused = 0, poolOverflow = 0;
+    // 写入队列：容量/最大深度取各写入线程的最大值，生产者阻塞与消费者空等时间累加
+    int queueCapacity = 0, queueMaxDepth = 0;
+    double producerStallMs = 0, consumerIdleMs = 0;
+    // CPU 合成：合成线程数(分段渲染为每段)与分块大小(元素)，OpenCL 合成时为 0；segments = 并行段数，串行渲染为 0
+    int compositeThreads = 0, segments = 0;
+    qint64 tileElems = 0;
+
+    const StageStat &operator[](RenderStage s) const { return stages[(int)s]; }
+    static const char *stageName(RenderStage s);
+    // 渲染线程的瓶颈：等待解码、等待编码，或自身的合成工作
+    QString bottleneck() const;
+    QString summary() const;
+    // 资源统计(帧池等)，渲染结束后由命令行报告输出；没有数据时为空
+    QString resourceSummary() const;
+    QJsonObject toJson() const;
+};
+Q_DECLARE_METATYPE(RenderStats)
+
+class RenderTrace {
+public:
+    RenderTrace();
+    // 清空统计并重新计时；events 为 true 时记录逐次事件用于导出
+    void reset(bool events);
+    qint64 nowNs() const;
+    void record(RenderStage stage, qint64 startNs, qint64 endNs);
+    // 累计一帧的跳块统计
+    void addBlocks(qint64 total, qint64 skipped);
+    // 渲染结束时累计帧池统计
+    void addFramePool(qint64 capacity, qint64 allocated, qint64 reused, qint64 overflow);
+    // 写入线程结束时累计其队列统计
+    void addWriterQueue(int capacity, int maxDepth, double producerStallMs, double consumerIdleMs);
+    void setComposite(int threads, qint64 tileElems);
+    void setSegments(int segments);
+    // 为当前线程命名(trace 中的线程轨道名)
+    void nameThread(const QString &name);
+    RenderStats snapshot() const;
+    bool exportChrome(const QString &path) const;
+
+private:
+    struct Event { qint64 startNs, endNs; int tid; RenderStage stage; };
+
+    std::chrono::steady_clock::time_point m_origin;
+    bool m_events;
+    mutable QMutex m_mutex;
+    RenderStats m_stats;
+    std::vector<Event> m_log;
+    QHash<int, QString> m_threadNames;
+};
+
+// 作用域计时；trace 为空时不计时
+class StageScope {
+public:
+    StageScope(RenderTrace *trace, RenderStage stage) : m_trace(trace), m_stage(stage), m_start(trace ? trace->nowNs() : 0) {}
+    ~StageScope() { if (m_trace) m_trace->record(m_stage, m_start, m_trace->nowNs()); }
+private:
+    RenderTrace *m_trace;
+    RenderStage m_stage;
+    qint64 m_start;
+};
+
+#endif // RENDERTRACE_H
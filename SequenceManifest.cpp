@@ -0,0 +1,191 @@
+#include "SequenceManifest.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+const int kManifestVersion = 1;
+
+struct Manifest {
+    qint64 dirMtime = 0;
+    QStringList filters;            // 空 = 由 openFiles 按显式文件列表生成
+    QStringList names;
+    QVector<qint64> sizes, mtimes;
+    SequenceInfo info;
+};
+
+// 同一进程内反复打开(预览、渲染、分段线程)不再解析 JSON
+QMutex g_memoMutex;
+QHash<QString, Manifest> g_memo;
+
+qint64 mtimeMs(const QFileInfo &fi) { return fi.lastModified().toMSecsSinceEpoch(); }
+
+bool loadManifest(const QString &dir, Manifest &m) {
+    QString path = SequenceManifest::manifestPath(dir);
+    { QMutexLocker l(&g_memoMutex); auto it = g_memo.constFind(path); if (it != g_memo.constEnd()) { m = it.value(); return true; } }
+    QFile f(path); if (!f.open(QIODevice::ReadOnly)) return false;
+    QJsonObject o = QJsonDocument::fromJson(f.readAll()).object();
+    if (o.value("version").toInt() != kManifestVersion) return false;
+    m.dirMtime = (qint64)o.value("dirMtime").toDouble();
+    for (const QJsonValue &v : o.value("filters").toArray()) m.filters << v.toString();
+    QDir d(dir);
+    for (const QJsonValue &v : o.value("files").toArray()) {
+        QJsonArray e = v.toArray(); if (e.size() != 3) return false;
+        m.names << e[0].toString(); m.sizes << (qint64)e[1].toDouble(); m.mtimes << (qint64)e[2].toDouble(); m.info.files << d.filePath(m.names.last());
+    }
+    m.info.width = o.value("width").toInt(); m.info.height = o.value("height").toInt(); m.info.bitDepth = o.value("bitDepth").toInt(8);
+    m.info.channels = o.value("channels").toInt(); m.info.tiffPage = o.value("tiffPage").toInt(-1);
+    if (m.names.isEmpty()) return false;
+    QMutexLocker l(&g_memoMutex); g_memo.insert(path, m);
+    return true;
+}
+
+// 廉价校验：目录修改时间 + 首尾两个文件的大小/修改时间，共 3 次 stat
+bool isFresh(const QString &dir, const Manifest &m) {
+    if (mtimeMs(QFileInfo(dir)) != m.dirMtime) return false;
+    for (int i : {0, (int)m.names.size() - 1}) {
+        QFileInfo fi(m.info.files[i]);
+        if (!fi.exists() || fi.size() != m.sizes[i] || mtimeMs(fi) != m.mtimes[i]) return false;
+    }
+    return true;
+}
+
+void saveManifest(const QString &dir, const Manifest &m, bool writable) {
+    QString path = SequenceManifest::manifestPath(dir);
+    { QMutexLocker l(&g_memoMutex); g_memo.insert(path, m); }
+    QJsonArray files; for (int i = 0; i < m.names.size(); ++i) files.append(QJsonArray{m.names[i], (double)m.sizes[i], (double)m.mtimes[i]});
+    QJsonObject o{{"version", kManifestVersion}, {"dirMtime", (double)m.dirMtime}, {"filters", QJsonArray::fromStringList(m.filters)}, {"files", files},
+                  {"width", m.info.width}, {"height", m.info.height}, {"bitDepth", m.info.bitDepth}, {"channels", m.info.channels}, {"tiffPage", m.info.tiffPage}};
+    // 只读目录(光盘、只读共享)写不了清单时只保留进程内缓存
+    if (!writable) return;
+    QSaveFile f(path);
+    if (f.open(QIODevice::WriteOnly)) { f.write(QJsonDocument(o).toJson(QJsonDocument::Compact)); if (!f.commit()) qDebug() << "Sequence manifest write failed:" << path; }
+}
+}
+
+// ================= SequenceManifest Implementation =================
+QString SequenceManifest::manifestPath(const QString &dir) { return QDir(dir).filePath(".startrails_proxy/sequence.json"); }
+
+bool SequenceManifest::openDirectory(const QString &dir, const QStringList &filters, SequenceInfo &info) {
+    QString absDir = QDir(dir).absolutePath(); Manifest m;
+    if (loadManifest(absDir, m) && m.filters == filters && isFresh(absDir, m)) { info = m.info; return true; }
+    QFileInfoList entries = QDir(absDir).entryInfoList(filters, QDir::Files);
+    return build(absDir, entries, filters, info);
+}
+
+bool SequenceManifest::openFiles(const QStringList &files, SequenceInfo &info) {
+    if (files.isEmpty()) return false;
+    QStringList sorted = files; sorted.sort();
+    QString absDir = QFileInfo(sorted.first()).absolutePath(); QStringList names;
+    for (const QString &f : sorted) {
+        QFileInfo fi(f);
+        if (fi.absolutePath() != absDir) { info = SequenceInfo(); info.files = sorted; probeHeader(sorted.first(), info); return true; } // 跨目录：不建清单
+        names << fi.fileName();
+    }
+    Manifest m;
+    if (loadManifest(absDir, m) && m.names == names && isFresh(absDir, m)) { info = m.info; return true; }
+    QFileInfoList entries; for (const QString &f : sorted) entries << QFileInfo(f);
+    return build(absDir, entries, QStringList(), info);
+}
+
+bool SequenceManifest::build(const QString &dir, const QFileInfoList &entries, const QStringList &filters, SequenceInfo &info) {
+    // 先建好缓存目录再取目录修改时间，否则首次建目录本身就让清单失效
+    bool writable = QDir().mkpath(QFileInfo(manifestPath(dir)).absolutePath());
+    Manifest m; m.filters = filters; m.dirMtime = mtimeMs(QFileInfo(dir));
+    QFileInfoList sorted = entries;
+    std::sort(sorted.begin(), sorted.end(), [](const QFileInfo &a, const QFileInfo &b) { return a.fileName() < b.fileName(); });
+    for (const QFileInfo &fi : sorted) {
+        if (!fi.exists()) continue;
+        m.names << fi.fileName(); m.sizes << fi.size(); m.mtimes << mtimeMs(fi); m.info.files << fi.absoluteFilePath();
+    }
+    if (m.names.isEmpty()) return false;
+    // 只读首帧文件头；格式不支持时尺寸留 0，由调用方解码首帧
+    probeHeader(m.info.files.first(), m.info);
+    saveManifest(dir, m, writable);
+    info = m.info;
+    return true;
+}
+
+bool SequenceManifest::probeHeader(const QString &path, SequenceInfo &info) {
+    QString ext = QFileInfo(path).suffix().toLower();
+    if (ext == "dng" || ext == "tif" || ext == "tiff" || ext == "cr2" || ext == "nef" || ext == "arw") return largestTiffPage(path, &info) >= 0;
+
+    QFile f(path); if (!f.open(QIODevice::ReadOnly)) return false;
+    auto be16 = [](const uchar *p) { return (int)(p[0] << 8 | p[1]); };
+    QByteArray head = f.read(32); const uchar *h = (const uchar*)head.constData();
+    if (head.size() >= 26 && head.startsWith("\x89PNG\r\n\x1a\n") && head.mid(12, 4) == "IHDR") {
+        static const int pngChannels[7] = {1, 0, 3, 3, 2, 0, 4}; int colorType = h[25];
+        info.width = be16(h + 16) << 16 | be16(h + 18); info.height = be16(h + 20) << 16 | be16(h + 22);
+        info.bitDepth = h[24] > 8 ? 16 : 8; info.channels = colorType < 7 ? pngChannels[colorType] : 0; info.tiffPage = -1;
+        return info.width > 0 && info.height > 0;
+    }
+    if (head.size() >= 4 && h[0] == 0xFF && h[1] == 0xD8) {
+        // 顺着标记段找 SOFn (跳过 DHT/JPG/DAC)，EXIF 缩略图在 APP1 段内，不会被误认
+        qint64 pos = 2;
+        for (int guard = 0; guard < 256 && f.seek(pos); ++guard) {
+            QByteArray seg = f.read(10); if (seg.size() < 4) break;
+            const uchar *s = (const uchar*)seg.constData();
+            if (s[0] != 0xFF) break;
+            int marker = s[1];
+            if (marker == 0xFF) { pos += 1; continue; } // 填充字节
+            if (marker == 0xD9 || marker == 0xDA) break;
+            int len = be16(s + 2);
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                if (seg.size() < 10) break;
+                info.bitDepth = s[4] > 8 ? 16 : 8; info.height = be16(s + 5); info.width = be16(s + 7); info.channels = s[9]; info.tiffPage = -1;
+                return info.width > 0 && info.height > 0;
+            }
+            pos += 2 + len;
+        }
+    }
+    return false;
+}
+
+int SequenceManifest::largestTiffPage(const QString &path, SequenceInfo *info) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return -1;
+    QByteArray hdr = f.read(8);
+    if (hdr.size() < 8) return -1;
+    bool le = hdr.startsWith("II"); if (!le && !hdr.startsWith("MM")) return -1;
+    auto u16 = [le](const uchar *p) { return le ? (quint32)(p[0] | p[1] << 8) : (quint32)(p[0] << 8 | p[1]); };
+    auto u32 = [le](const uchar *p) { return le ? (quint32)p[0] | (quint32)p[1] << 8 | (quint32)p[2] << 16 | (quint32)p[3] << 24
+                                                : (quint32)p[0] << 24 | (quint32)p[1] << 16 | (quint32)p[2] << 8 | (quint32)p[3]; };
+    const uchar *h = (const uchar*)hdr.constData();
+    if (u16(h + 2) != 42) return -1;
+
+    quint32 offset = u32(h + 4); int best = -1; qint64 bestPixels = 0;
+    quint32 bestW = 0, bestH = 0, bestBits = 8, bestSpp = 1; qint64 bestBitsOffset = -1;
+    QList<quint32> visited;
+    for (int page = 0; offset != 0 && page < 64 && !visited.contains(offset); ++page) {
+        visited << offset;
+        if (!f.seek(offset)) break;
+        QByteArray cnt = f.read(2); if (cnt.size() < 2) break;
+        int n = (int)u16((const uchar*)cnt.constData());
+        QByteArray ifd = f.read(n * 12 + 4); if (ifd.size() < n * 12 + 4) break;
+        const uchar *e = (const uchar*)ifd.constData();
+        quint32 w = 0, hgt = 0, bits = 8, spp = 1; qint64 bitsOffset = -1;
+        for (int i = 0; i < n; ++i, e += 12) {
+            quint32 tag = u16(e), type = u16(e + 2), count = u32(e + 4);
+            quint32 v = (type == 3) ? u16(e + 8) : u32(e + 8); // SHORT 存在值域的前 2 字节
+            if (tag == 256) w = v; else if (tag == 257) hgt = v; else if (tag == 277) spp = v;
+            else if (tag == 258) { if (count <= 2) bits = v; else bitsOffset = u32(e + 8); } // 多通道的 BitsPerSample 存在别处
+        }
+        if ((qint64)w * hgt > bestPixels) { bestPixels = (qint64)w * hgt; best = page; bestW = w; bestH = hgt; bestBits = bits; bestSpp = spp; bestBitsOffset = bitsOffset; }
+        offset = u32(e);
+    }
+    if (info && best >= 0) {
+        if (bestBitsOffset >= 0 && f.seek(bestBitsOffset)) { QByteArray b = f.read(2); if (b.size() == 2) bestBits = u16((const uchar*)b.constData()); }
+        info->width = (int)bestW; info->height = (int)bestH; info->bitDepth = bestBits > 8 ? 16 : 8; info->channels = (int)bestSpp; info->tiffPage = best;
+    }
+    return best;
+}
@@ -0,0 +1,40 @@
+#ifndef SEQUENCEMANIFEST_H
+#define SEQUENCEMANIFEST_H
+
+#include <QString>
+#include <QStringList>
+#include <QFileInfoList>
+
+// --- 图片序列清单 ---
+// 序列目录旁(.startrails_proxy/sequence.json)缓存排好序的文件列表、每个文件的大小与修改时间、
+// 首帧尺寸/位深(只解析文件头)以及 RAW 选中的 TIFF 页。再次打开时只比对目录修改时间与首尾两个文件，
+// 不列目录、不读图片，数千张网络存储上的 RAW 也能在毫秒级打开。
+// 校验不逐个 stat：目录内增删改名会改变目录修改时间，原地覆盖中间的文件不会被发现。
+struct SequenceInfo {
+    QStringList files;   // 绝对路径，按文件名排序
+    int width = 0;
+    int height = 0;
+    int bitDepth = 8;    // 8 或 16
+    int channels = 0;
+    int tiffPage = -1;   // RAW/TIFF 的最大页，-1 = 非 TIFF 容器
+};
+
+class SequenceManifest {
+public:
+    // dir 下匹配 filters 的全部文件
+    static bool openDirectory(const QString &dir, const QStringList &filters, SequenceInfo &info);
+    // 已选定的文件(同一目录)；清单中的文件名与之一致时直接使用，否则按这些文件重建清单
+    static bool openFiles(const QStringList &files, SequenceInfo &info);
+
+    // 只读文件头取尺寸/位深/通道数(JPEG、PNG、TIFF 系 RAW)，不支持的格式返回 false
+    static bool probeHeader(const QString &path, SequenceInfo &info);
+    // 只解析 TIFF 容器的主 IFD 链(与 OpenCV/libtiff 的页序一致)，不解码任何图像数据，
+    // 返回像素数最大的页序号；不是经典 TIFF(如 BigTIFF)或解析失败时返回 -1。info 非空时填入该页的尺寸与位深
+    static int largestTiffPage(const QString &path, SequenceInfo *info = nullptr);
+    static QString manifestPath(const QString &dir);
+
+private:
+    static bool build(const QString &dir, const QFileInfoList &entries, const QStringList &filters, SequenceInfo &info);
+};
+
+#endif // SEQUENCEMANIFEST_H
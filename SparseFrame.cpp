@@ -0,0 +1,72 @@
+#include "SparseFrame.h"
+#include "CompositeKernels.h"
+#include <algorithm>
+#include <cstring>
+
+// 段内各通道的最小/最大值，channels <= 4
+template <typename T>
+static void runRange(const T *src, size_t len, int channels, T *lo, T *hi) {
+    for (int c = 0; c < channels; ++c) { lo[c] = src[c]; hi[c] = src[c]; }
+    for (size_t i = channels; i < len; i += channels)
+        for (int c = 0; c < channels; ++c) { T v = src[i + c]; lo[c] = std::min(lo[c], v); hi[c] = std::max(hi[c], v); }
+}
+
+// ================= SparseFrame Implementation =================
+void SparseFrame::encode(const cv::Mat &frame, int tolerance, int threads) {
+    CV_Assert((frame.depth() == CV_8U || frame.depth() == CV_16U) && frame.channels() <= 4 && frame.isContinuous());
+    CV_Assert(frame.total() * frame.channels() < kFlat);
+    m_size = frame.size(); m_type = frame.type(); m_channels = frame.channels();
+    m_elems = frame.total() * m_channels; m_runElems = (size_t)kRunPixels * m_channels;
+    if (frame.depth() == CV_16U) encodeT<ushort>(frame, tolerance, threads); else encodeT<uchar>(frame, tolerance, threads);
+}
+
+// 两遍：先并行判断每段是否平坦并求前缀偏移，再并行写出数据
+template <typename T>
+void SparseFrame::encodeT(const cv::Mat &frame, int tolerance, int threads) {
+    const T *src = frame.ptr<T>(); const int C = m_channels; const size_t runElems = m_runElems;
+    const size_t nRuns = (m_elems + runElems - 1) / runElems; const int spread = 2 * std::max(0, tolerance);
+    auto runLen = [&](size_t r) { return std::min(runElems, m_elems - r * runElems); };
+    m_flat.resize(nRuns); m_runPos.resize(nRuns);
+    CompositeKernels::parallelTiles(nRuns, runElems * sizeof(T), threads, [&](size_t b, size_t e) {
+        T lo[4], hi[4];
+        for (size_t r = b; r < e; ++r) {
+            runRange(src + r * runElems, runLen(r), C, lo, hi); bool flat = true;
+            for (int c = 0; c < C; ++c) flat &= (int)hi[c] - (int)lo[c] <= spread;
+            m_flat[r] = flat;
+        }
+    });
+    size_t pos = 0; m_flatRuns = 0;
+    for (size_t r = 0; r < nRuns; ++r) {
+        if (m_flat[r]) { m_runPos[r] = (uint32_t)pos | kFlat; pos += C; m_flatRuns++; }
+        else { m_runPos[r] = (uint32_t)pos; pos += runLen(r); }
+    }
+    m_data.resize(pos * sizeof(T));
+    T *dst = reinterpret_cast<T*>(m_data.data());
+    CompositeKernels::parallelTiles(nRuns, runElems * sizeof(T) * 2, threads, [&](size_t b, size_t e) {
+        T lo[4], hi[4];
+        for (size_t r = b; r < e; ++r) {
+            const T *s = src + r * runElems; size_t len = runLen(r);
+            if (!(m_runPos[r] & kFlat)) { std::memcpy(dst + m_runPos[r], s, len * sizeof(T)); continue; }
+            // 中值：与段内任一值之差不超过 tolerance
+            runRange(s, len, C, lo, hi); T *d = dst + (m_runPos[r] & ~kFlat);
+            for (int c = 0; c < C; ++c) d[c] = (T)(lo[c] + (hi[c] - lo[c]) / 2);
+        }
+    });
+}
+
+template <typename T>
+void SparseFrame::maxInto(size_t begin, size_t end, T *dst, float w) const {
+    const T *data = reinterpret_cast<const T*>(m_data.data()); const int C = m_channels;
+    for (size_t r = begin / m_runElems, rs = r * m_runElems; rs < end; ++r, rs += m_runElems) {
+        size_t s = std::max(begin, rs), e = std::min(end, std::min(rs + m_runElems, m_elems)); uint32_t pos = m_runPos[r];
+        T *out = dst + (s - begin);
+        if (!(pos & kFlat)) { CompositeKernels::weightedMaxRow(data + pos + (s - rs), out, (int)(e - s), w); continue; }
+        // 平坦段：每个通道只算一次加权值 (走同一个内核，结果逐位一致)
+        T t[4] = {0, 0, 0, 0}; CompositeKernels::weightedMaxRow(data + (pos & ~kFlat), t, C, w);
+        int c = (int)(s % C);
+        for (size_t i = 0, n = e - s; i < n; ++i) { out[i] = std::max(out[i], t[c]); if (++c == C) c = 0; }
+    }
+}
+
+template void SparseFrame::maxInto<uchar>(size_t, size_t, uchar *, float) const;
+template void SparseFrame::maxInto<ushort>(size_t, size_t, ushort *, float) const;
@@ -0,0 +1,53 @@
+#ifndef SPARSEFRAME_H
+#define SPARSEFRAME_H
+
+#include <vector>
+#include <cstdint>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// --- 压缩拖尾帧 ---
+// 帧按 kRunPixels 个像素切段：段内每个通道的起伏不超过 2*tolerance 时只存各通道的中值(背景)，
+// 否则原样存储(星点、地景细节)。重建误差不超过 tolerance，tolerance = 0 时无损。
+// 星空帧绝大部分是平坦的背景噪声，长拖尾历史因此只占完整帧的一小部分；合成直接读取这种形式，不解压成整帧。
+class SparseFrame {
+public:
+    static constexpr int kRunPixels = 16;
+
+    // tolerance 以元素值为单位(16 位帧由调用方换算)；threads 同 CompositeKernels::parallelTiles
+    // 重复 encode 复用已有缓冲
+    void encode(const cv::Mat &frame, int tolerance, int threads);
+
+    // dst[i] = max(dst[i], saturate(v[begin + i] * w))，与 CompositeKernels::weightedMaxRow 逐位一致
+    template <typename T> void maxInto(size_t begin, size_t end, T *dst, float w) const;
+    // 单个元素的重建值
+    template <typename T> T at(size_t e) const {
+        size_t r = e / m_runElems; uint32_t pos = m_runPos[r];
+        const T *d = reinterpret_cast<const T*>(m_data.data());
+        return (pos & kFlat) ? d[(pos & ~kFlat) + e % m_channels] : d[pos + e - r * m_runElems];
+    }
+
+    cv::Size size() const { return m_size; }
+    int type() const { return m_type; }
+    bool empty() const { return m_elems == 0; }
+    size_t bytes() const { return m_runPos.size() * sizeof(uint32_t) + m_data.size(); }
+    // 平坦段所占比例，用于日志
+    double flatRatio() const { return m_runPos.empty() ? 0.0 : (double)m_flatRuns / m_runPos.size(); }
+
+private:
+    static constexpr uint32_t kFlat = 0x80000000u;
+    template <typename T> void encodeT(const cv::Mat &frame, int tolerance, int threads);
+
+    cv::Size m_size;
+    int m_type = 0;
+    int m_channels = 1;
+    size_t m_elems = 0;
+    size_t m_runElems = kRunPixels;
+    size_t m_flatRuns = 0;
+    std::vector<uint32_t> m_runPos;   // 每段数据在 m_data 中的元素偏移，最高位标记平坦段
+    std::vector<uchar> m_data;
+    std::vector<uchar> m_flat;        // 编码时的临时标记
+};
+
+#endif // SPARSEFRAME_H
@@ -8,33 +8,47 @@ TARGET = StarTrailsCpp
 TEMPLATE = app
 
 # --- OpenCV 配置 ---
-
-# 1. 头文件路径 (请确认路径存在)
-INCLUDEPATH += D:/opencv/build/include
-
-# 2. 库文件路径
-LIBS += -LD:/opencv/build/x64/vc16/lib
-
-# 3. 智能链接：Debug 模式链 debug 库，Release 模式链 release 库
-# 请务必根据你实际的文件名修改版本号 (例如 4100, 460, 480)
-CONFIG(debug, debug|release) {
-    # Debug 模式 (带 d)
-    LIBS += -lopencv_world4120d
-} else {
-    # Release 模式 (不带 d)
-    LIBS += -lopencv_world4120
-}
+include(opencv.pri)
 
 SOURCES += \
+    CompositeKernels.cpp \
+    FramePool.cpp \
+    HeadlessRunner.cpp \
     MainWindow.cpp \
+    OclTrailPipeline.cpp \
+    PreviewMailbox.cpp \
+    ProxyCache.cpp \
+    RenderCheckpoint.cpp \
+    RenderOutputs.cpp \
+    RenderTrace.cpp \
+    SequenceManifest.cpp \
+    SparseFrame.cpp \
+    TrailEngine.cpp \
+    VideoEncoder.cpp \
+    VideoIndex.cpp \
     main.cpp
 
 HEADERS += \
-    MainWindow.h
+    CompositeKernels.h \
+    FramePool.h \
+    HeadlessRunner.h \
+    MainWindow.h \
+    OclTrailPipeline.h \
+    PreviewMailbox.h \
+    ProxyCache.h \
+    RenderCheckpoint.h \
+    RenderOutputs.h \
+    RenderTrace.h \
+    SequenceManifest.h \
+    SparseFrame.h \
+    TrailEngine.h \
+    VideoEncoder.h \
+    VideoIndex.h
 
 # 禁用控制台窗口 (发布时)
 # CONFIG += windows
 
 DISTFILES += \
     Readme.md \
+    opencv.pri \
     star.py
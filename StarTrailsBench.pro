@@ -0,0 +1,46 @@
+# StarTrails 基准测试 (命令行程序)
+# 运行: StarTrailsBench --resolutions 1080p,4k,8k --depths 8,16 --frames 48 --output bench_results.json
+
+QT       += core gui widgets concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = StarTrailsBench
+TEMPLATE = app
+
+# --- OpenCV 配置 ---
+include(opencv.pri)
+
+SOURCES += \
+    Benchmark.cpp \
+    CompositeKernels.cpp \
+    FramePool.cpp \
+    MainWindow.cpp \
+    OclTrailPipeline.cpp \
+    PreviewMailbox.cpp \
+    ProxyCache.cpp \
+    RenderCheckpoint.cpp \
+    RenderOutputs.cpp \
+    RenderTrace.cpp \
+    SequenceManifest.cpp \
+    SparseFrame.cpp \
+    TrailEngine.cpp \
+    VideoEncoder.cpp \
+    VideoIndex.cpp
+
+HEADERS += \
+    CompositeKernels.h \
+    FramePool.h \
+    MainWindow.h \
+    OclTrailPipeline.h \
+    PreviewMailbox.h \
+    ProxyCache.h \
+    RenderCheckpoint.h \
+    RenderOutputs.h \
+    RenderTrace.h \
+    SequenceManifest.h \
+    SparseFrame.h \
+    TrailEngine.h \
+    VideoEncoder.h \
+    VideoIndex.h
@@ -0,0 +1,153 @@
+#include "TrailEngine.h"
+#include "CompositeKernels.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+
+// ================= TrailEngine Implementation =================
+TrailEngine::TrailEngine() : m_trailLength(1), m_fadeStrength(0.0), m_tolerance(-1), m_sparseMode(false), m_peakBytes(0), m_allocator(nullptr), m_threads(0), m_incremental(true), m_seq(0), m_dirtyScans(0), m_scanFrames(0), m_dirtyRate(0.0), m_switchedToFold(false) {}
+
+void TrailEngine::reset(int trailLength, double fadeStrength) {
+    m_trailLength = std::max(1, trailLength); m_fadeStrength = fadeStrength;
+    m_weights.clear(); float fadeStart = std::max(0.05, 1.0 - fadeStrength);
+    for(int i=0; i<m_trailLength; ++i) { float t=(float)i/std::max(1,m_trailLength-1); m_weights.push_back(fadeStart+t*(1.0f-fadeStart)); }
+    // 帧龄用 uint16 记录，超长拖尾退回逐帧合成；16 位帧在首次 push() 时切换
+    m_incremental = m_trailLength > kFoldMaxTrail && m_trailLength <= 65535;
+    m_history.clear(); m_sparse.clear(); m_out.release(); m_seq = 0; m_sparseMode = m_tolerance >= 0;
+    m_candVal.clear(); m_candSeq.clear(); m_candCount.clear(); m_dirty.clear();
+    m_dirtyScans = 0; m_scanFrames = 0; m_dirtyRate = 0.0; m_switchedToFold = false;
+    if (m_incremental) buildTables();
+}
+
+void TrailEngine::buildTables() {
+    // 按帧龄建表：age 0 = 最新帧，对应 weights[L-1]
+    int L = m_trailLength;
+    m_lutScaled.assign((size_t)L * 256, 0); m_lutEffective.assign((size_t)L * 256, 0);
+    for (int age = 0; age < L; ++age) {
+        float w = m_weights[L - 1 - age];
+        uchar *sc = &m_lutScaled[(size_t)age * 256]; uchar *ef = &m_lutEffective[(size_t)age * 256];
+        for (int v = 0; v < 256; ++v) { sc[v] = cv::saturate_cast<uchar>((float)v * w); ef[v] = (w > 0.99f) ? (uchar)v : sc[v]; }
+    }
+}
+
+void TrailEngine::push(const cv::Mat &frame) {
+    CV_Assert(frame.depth() == CV_8U || frame.depth() == CV_16U);
+    cv::Mat f = frame.isContinuous() ? frame : frame.clone();
+    if (!m_out.empty() && (m_out.size() != f.size() || m_out.type() != f.type())) reset(m_trailLength, m_fadeStrength);
+    if (m_sparseMode) {
+        // 复用滑出窗口那一帧的缓冲；压缩模式不持有原始帧，帧池缓冲随即归还
+        SparseFrame sf; if (m_sparse.size() >= (size_t)m_trailLength) { sf = std::move(m_sparse.front()); m_sparse.pop_front(); }
+        int tol = f.depth() == CV_16U ? m_tolerance * 257 : m_tolerance;
+        sf.encode(f, tol, m_threads); m_sparse.push_back(std::move(sf));
+    } else { m_history.push_back(f); if (m_history.size() > (size_t)m_trailLength) m_history.pop_front(); }
+    m_cur = f; m_seq++;
+
+    prepareOutput(f);
+    if (f.depth() == CV_16U) { if (m_incremental) { m_incremental = false; dropCandidates(); } compositeReference<ushort>(); }
+    else { if (m_incremental) compositeIncremental(); else compositeReference<uchar>(); }
+    if (m_incremental) updateFoldSwitch(f.total() * f.channels());
+    if (historySize() == 1) f.copyTo(m_out);
+    m_cur.release(); m_peakBytes = std::max(m_peakBytes, historyBytes());
+}
+
+// 窗口填满后按周期统计逐帧扫描占比；超过阈值时丢弃候选栈，之后的帧走逐帧融合合成(历史帧两条路径共用)
+void TrailEngine::updateFoldSwitch(size_t elems) {
+    if (historySize() < m_trailLength) { m_dirtyScans = 0; return; }
+    if (++m_scanFrames < kFoldCheckFrames) return;
+    m_dirtyRate = (double)m_dirtyScans.exchange(0) / ((double)elems * m_scanFrames); m_scanFrames = 0;
+    if (m_dirtyRate <= kFoldSwitchRate) return;
+    m_incremental = false; m_switchedToFold = true; dropCandidates();
+}
+
+void TrailEngine::dropCandidates() {
+    std::vector<uchar>().swap(m_candVal); std::vector<uint16_t>().swap(m_candSeq); std::vector<uchar>().swap(m_candCount); std::vector<uint16_t>().swap(m_dirty);
+}
+
+size_t TrailEngine::historyBytes() const {
+    size_t total = 0;
+    for (const SparseFrame &sf : m_sparse) total += sf.bytes();
+    for (const cv::Mat &m : m_history) total += m.total() * m.elemSize();
+    return total;
+}
+
+void TrailEngine::prepareOutput(const cv::Mat &like) {
+    // 使用分配器时每帧取新缓冲，上一帧输出可能仍在写入队列中
+    if (m_allocator) { m_out = cv::Mat(); m_out.allocator = m_allocator; }
+    m_out.create(like.size(), like.type());
+}
+
+// 每个元素在一块内触及的字节数，用来把块大小控制在 L2 内
+size_t TrailEngine::candBytesPerElem() const { return (kSlots + 2) + sizeof(uint16_t) * (kSlots + 1) + 1; }
+
+size_t TrailEngine::tileElems() const {
+    size_t esz = m_out.empty() ? 1 : m_out.elemSize1();
+    return CompositeKernels::tileElems(m_incremental ? candBytesPerElem() : esz * 2);
+}
+
+template <typename T>
+void TrailEngine::compositeReference() {
+    size_t bLen = historySize(); if (bLen <= 1) return;
+    CompositeKernels::parallelTiles(m_out.total() * m_out.channels(), sizeof(T) * 2, m_threads, [this](size_t b, size_t e) { foldTile<T>(b, e); });
+}
+
+// 一块输出依次折叠窗口内全部帧：输出块常驻缓存，每帧的对应块只读一遍
+// 最旧帧 = convertScaleAbs (累加器清零后取加权 max 等价)，其余帧 w > 0.99 时直接取 max
+template <typename T>
+void TrailEngine::foldTile(size_t begin, size_t end) {
+    size_t bLen = historySize(); int off = m_trailLength - (int)bLen; int len = (int)(end - begin);
+    T *dst = m_out.ptr<T>() + begin; int type = CV_MAKETYPE(m_out.depth(), 1);
+    std::memset(dst, 0, len * sizeof(T));
+    if (m_sparseMode) {
+        // w > 0.99 的 max 与 w = 1 的加权 max 结果相同
+        m_sparse[0].maxInto<T>(begin, end, dst, m_weights[off]);
+        for (size_t k = 1; k < bLen; ++k) { float w = m_weights[off + k]; m_sparse[k].maxInto<T>(begin, end, dst, w > 0.99f ? 1.0f : w); }
+        return;
+    }
+    CompositeKernels::weightedMaxRow(m_history[0].ptr<T>() + begin, dst, len, m_weights[off]);
+    cv::Mat acc(1, len, type, dst);
+    for (size_t k = 1; k < bLen; ++k) {
+        const T *src = m_history[k].ptr<T>() + begin; float w = m_weights[off + k];
+        if (w > 0.99f) cv::max(acc, cv::Mat(1, len, type, (void*)src), acc); else CompositeKernels::weightedMaxRow(src, dst, len, w);
+    }
+}
+
+// 原实现中最旧的一帧总是经过 convertScaleAbs，其余帧权重 > 0.99 时直接取 max (termAt 的两张表)
+void TrailEngine::compositeIncremental() {
+    const size_t n = m_cur.total() * m_cur.channels();
+    if (m_candCount.size() != n) { m_candVal.assign(n * kSlots, 0); m_candSeq.assign(n * kSlots, 0); m_candCount.assign(n, 0); m_dirty.assign(n, 0); }
+    CompositeKernels::parallelTiles(n, candBytesPerElem(), m_threads, [this](size_t b, size_t e) { incrementalTile(b, e); });
+}
+
+void TrailEngine::incrementalTile(size_t begin, size_t end) {
+    const int L = m_trailLength; const int bLen = historySize();
+    const uchar *src = m_cur.ptr<uchar>(); uchar *dst = m_out.ptr<uchar>(); uchar *cand = m_candVal.data(); size_t scans = 0;
+    for (size_t e = begin; e < end; ++e) {
+        uchar *V = &cand[e * kSlots]; uint16_t *S = &m_candSeq[e * kSlots]; int cnt = m_candCount[e];
+
+        // 1. 最旧的候选滑出窗口 (每帧最多一个)
+        if (cnt > 0 && (uint16_t)(m_seq - S[0]) >= L) { std::memmove(V, V + 1, (cnt - 1)); std::memmove(S, S + 1, (cnt - 1) * sizeof(uint16_t)); cnt--; }
+
+        // 2. 新值不小于的候选永远不会再胜出
+        uchar v = src[e];
+        while (cnt > 0 && V[cnt - 1] <= v) cnt--;
+
+        // 3. 栈满：丢弃最旧候选，在它过期前该像素走逐帧扫描
+        if (cnt == kSlots) {
+            uint16_t remaining = (uint16_t)(L - (uint16_t)(m_seq - S[0]));
+            if (m_dirty[e] < remaining) m_dirty[e] = remaining;
+            std::memmove(V, V + 1, (cnt - 1)); std::memmove(S, S + 1, (cnt - 1) * sizeof(uint16_t)); cnt--;
+        }
+        V[cnt] = v; S[cnt] = m_seq; cnt++; m_candCount[e] = (uchar)cnt;
+
+        uchar best = 0;
+        if (m_dirty[e] > 0) {
+            m_dirty[e]--; scans++;
+            if (m_sparseMode) for (int k = 0; k < bLen; ++k) best = std::max(best, termAt(bLen - 1 - k, m_sparse[k].at<uchar>(e), k == 0));
+            else for (int k = 0; k < bLen; ++k) best = std::max(best, termAt(bLen - 1 - k, m_history[k].ptr<uchar>()[e], k == 0));
+        } else {
+            for (int s = 0; s < cnt; ++s) { int age = (uint16_t)(m_seq - S[s]); best = std::max(best, termAt(age, V[s], age == bLen - 1)); }
+        }
+        dst[e] = best;
+    }
+    m_dirtyScans += scans;
+}
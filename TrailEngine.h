@@ -0,0 +1,100 @@
+#ifndef TRAILENGINE_H
+#define TRAILENGINE_H
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+#include "CompositeKernels.h"
+#include "SparseFrame.h"
+
+// --- 彗星模式拖尾引擎 ---
+// 输出 = max_k saturate(buffer[k] * weights[off + k])，与原先逐帧 convertScaleAbs + max 的结果逐位一致。
+// 增量算法：权重只随帧龄单调递减，所以每个像素只需保留“比所有更新帧都亮”的候选帧(单调栈)，
+// 新帧入栈时弹出被它支配的候选，输出时只扫描候选栈。均摊开销与 trailLength 无关。
+// 候选栈容量固定(kSlots)，溢出的像素在被丢弃的候选过期前回退为逐帧扫描，保证结果精确。
+// 噪声大的天空里候选栈频繁溢出，逐帧扫描的像素比例超过 kFoldSwitchRate 时本次 reset 内改走逐帧融合合成。
+// 短拖尾、超长拖尾(帧龄超出 uint16)与 16 位帧走逐帧融合合成 (CompositeKernels)。
+// 16 位像素值几乎不会相等，单调栈很快溢出：背景噪声 4 灰阶时约 40% 的像素每帧都在逐帧扫描，比融合合成慢约 10 倍。
+// 两种路径都按块并行：每个像素只依赖自己的历史与候选栈，块之间没有数据依赖。
+// 历史默认保存完整帧；设置压缩误差后改存 SparseFrame(背景段 + 原样段)，合成直接读取压缩形式，
+// 输出与完整帧合成之差不超过该误差，200 帧 8K 拖尾的历史内存从数十 GB 降到几 GB。
+class TrailEngine {
+public:
+    static constexpr int kSlots = 6;
+    // 短拖尾逐帧 SIMD 融合合成比逐像素候选栈更快
+    static constexpr int kFoldMaxTrail = 16;
+    // 逐帧扫描的像素占比超过该值时增量算法不再划算(基准: 8 位 240 帧拖尾盈亏点约 1.7%，120 帧约 0.8%)
+    static constexpr double kFoldSwitchRate = 0.01;
+    // 窗口填满后每隔多少帧统计一次扫描占比
+    static constexpr int kFoldCheckFrames = 16;
+
+    TrailEngine();
+    void reset(int trailLength, double fadeStrength);
+    // frame: 8 位或 16 位图像(任意通道数)，引擎持有其引用，调用方不要再修改它
+    // 每帧按位深分派一次到对应的模板实现，像素循环内没有位深分支；16 位帧使 isIncremental() 变为 false
+    void push(const cv::Mat &frame);
+    // 当前拖尾合成结果；未设置 allocator 时缓冲在下一次 push() 时被复用
+    const cv::Mat &output() const { return m_out; }
+    int historySize() const { return (int)(m_sparseMode ? m_sparse.size() : m_history.size()); }
+    // 拖尾历史的压缩误差上限(8 位灰阶，16 位帧按 x257 换算)；-1 = 保存完整帧(逐位精确)。reset() 之前设置
+    void setHistoryTolerance(int levels) { m_tolerance = levels; }
+    int historyTolerance() const { return m_tolerance; }
+    // 当前与峰值历史内存(字节)，不含候选栈
+    size_t historyBytes() const;
+    size_t peakHistoryBytes() const { return m_peakBytes; }
+    // 每帧输出分配自 allocator(通常是 FramePool)，输出可直接交给写入线程而无需拷贝
+    void setAllocator(cv::MatAllocator *allocator) { m_allocator = allocator; }
+    bool isIncremental() const { return m_incremental; }
+    // 最近一个统计周期内逐帧扫描的像素占比；switchedToFold() = 因占比过高已切换到逐帧融合合成
+    double dirtyScanRate() const { return m_dirtyRate; }
+    bool switchedToFold() const { return m_switchedToFold; }
+    // 合成按缓存大小分块、多线程并行，每块一次折叠完整个拖尾窗口；0 = 全部核心
+    void setThreads(int threads) { m_threads = threads; }
+    int threads() const { return CompositeKernels::effectiveThreads(m_threads); }
+    size_t tileElems() const;
+
+private:
+    void buildTables();
+    void prepareOutput(const cv::Mat &like);
+    template <typename T> void compositeReference();
+    void compositeIncremental();
+    template <typename T> void foldTile(size_t begin, size_t end);
+    void incrementalTile(size_t begin, size_t end);
+    size_t candBytesPerElem() const;
+    void dropCandidates();
+    uchar termAt(int age, uchar v, bool oldest) const { return (oldest ? m_lutScaled : m_lutEffective)[(size_t)age * 256 + v]; }
+    void updateFoldSwitch(size_t elems);
+
+    int m_trailLength;
+    double m_fadeStrength;
+    std::vector<float> m_weights;        // 与 ProcessorThread 原实现相同的线性权重
+    std::vector<uchar> m_lutScaled;      // 8 位: [age * 256 + v] = saturate(v * w)
+    std::vector<uchar> m_lutEffective;   // 同上，但 w > 0.99 时按 1.0 处理(原实现的快捷路径)
+    std::deque<cv::Mat> m_history;       // 最近 trailLength 帧，front 最旧
+    std::deque<SparseFrame> m_sparse;    // 压缩模式下代替 m_history
+    cv::Mat m_cur;                       // push() 期间的最新帧
+    int m_tolerance;
+    bool m_sparseMode;
+    size_t m_peakBytes;
+    cv::Mat m_out;
+    cv::MatAllocator *m_allocator;
+    int m_threads;
+
+    bool m_incremental;
+    uint16_t m_seq;                      // 当前帧序号(模 65536)
+    std::vector<uchar> m_candVal;        // [e * kSlots + s]，s=0 最旧
+    std::vector<uint16_t> m_candSeq;
+    std::vector<uchar> m_candCount;
+    std::vector<uint16_t> m_dirty;       // >0: 候选栈不完整，剩余需逐帧扫描的帧数
+    std::atomic<size_t> m_dirtyScans;    // 本统计周期内逐帧扫描的像素数(各块累加)
+    int m_scanFrames;
+    double m_dirtyRate;
+    bool m_switchedToFold;
+};
+
+#endif // TRAILENGINE_H
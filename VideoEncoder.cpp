@@ -0,0 +1,164 @@
+#include "VideoEncoder.h"
+#include <QStandardPaths>
+#include <QProcess>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include <pthread.h>
+extern char **environ;
+
+namespace {
+// 写管道期间在本线程屏蔽 SIGPIPE：ffmpeg 提前退出时 write 返回 EPIPE，而不是终止整个进程；
+// 不改进程级的信号处理，离开作用域前取走本次产生的 SIGPIPE 再恢复原屏蔽字
+class SigPipeBlock {
+public:
+    SigPipeBlock() : m_epipe(false) {
+        sigemptyset(&m_set); sigaddset(&m_set, SIGPIPE);
+        sigset_t pending; sigpending(&pending); m_wasPending = sigismember(&pending, SIGPIPE) == 1;
+        if (!m_wasPending) pthread_sigmask(SIG_BLOCK, &m_set, &m_old);
+    }
+    ~SigPipeBlock() {
+        if (m_wasPending) return;
+        if (m_epipe) { sigset_t pending; sigpending(&pending); if (sigismember(&pending, SIGPIPE) == 1) { int sig; sigwait(&m_set, &sig); } }
+        pthread_sigmask(SIG_SETMASK, &m_old, nullptr);
+    }
+    void sawEpipe() { m_epipe = true; }
+private:
+    sigset_t m_set, m_old; bool m_wasPending, m_epipe;
+};
+
+// 管道两端都带 CLOEXEC：分段渲染的多个编码器并发启动时，一个 ffmpeg 不能继承另一个的管道写端，
+// 否则后者永远等不到 EOF。子进程的 stdin 经 dup2 得到，不受影响
+bool cloexecPipe(int fds[2]) {
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD) || defined(Q_OS_NETBSD) || defined(Q_OS_OPENBSD)
+    return ::pipe2(fds, O_CLOEXEC) == 0;
+#else
+    // 没有 pipe2 的系统(macOS)：pipe 与 fcntl 之间有空隙，靠 g_spawnMutex 挡住本进程内其他编码器的启动
+    if (::pipe(fds) != 0) return false;
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC); ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+QMutex g_spawnMutex; // 创建管道到启动 ffmpeg 串行化
+}
+#endif
+
+// ================= VideoEncoder Implementation =================
+VideoEncoder *VideoEncoder::create(const EncoderSettings &settings) {
+    if (settings.backend == EncoderSettings::FFmpegPipe) return new FfmpegPipeEncoder(settings);
+    return new OpenCvEncoder;
+}
+
+// ================= OpenCvEncoder Implementation =================
+bool OpenCvEncoder::open(const QString &path, cv::Size size, double fps, bool) {
+    int fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+    if (!m_writer.open(path.toStdString(), fourcc, fps, size)) { m_error = "OpenCV 无法打开视频写入器: " + path; return false; }
+    return true;
+}
+bool OpenCvEncoder::write(const cv::Mat &frame) { m_writer.write(frame); return true; }
+bool OpenCvEncoder::close() { m_writer.release(); return true; }
+
+// ================= FfmpegPipeEncoder Implementation =================
+#ifdef Q_OS_UNIX
+FfmpegPipeEncoder::FfmpegPipeEncoder(const EncoderSettings &settings) : m_settings(settings), m_fd(-1), m_pid(-1) {}
+#else
+FfmpegPipeEncoder::FfmpegPipeEncoder(const EncoderSettings &settings) : m_settings(settings), m_proc(nullptr) {}
+#endif
+FfmpegPipeEncoder::~FfmpegPipeEncoder() { close(); }
+
+QStringList FfmpegPipeEncoder::buildArgs(const EncoderSettings &s, const QString &path, cv::Size size, double fps, bool isMov) {
+    QStringList a{"-hide_banner", "-loglevel", "error", "-y",
+                  "-f", "rawvideo", "-pix_fmt", "bgr24", "-s", QString("%1x%2").arg(size.width).arg(size.height), "-framerate", QString::number(fps, 'g', 10), "-i", "-",
+                  "-an", "-c:v", s.codec};
+    if (!s.preset.isEmpty()) a << "-preset" << s.preset;
+    if (s.bitrateKbps > 0) a << "-b:v" << QString("%1k").arg(s.bitrateKbps); else if (s.crf >= 0) a << "-crf" << QString::number(s.crf);
+    if (s.threads > 0) a << "-threads" << QString::number(s.threads);
+    if (!s.pixFmt.isEmpty()) a << "-pix_fmt" << s.pixFmt;
+    if (s.codec.contains("265") || s.codec.contains("hevc")) a << "-tag:v" << "hvc1"; // QuickTime/相册只认 hvc1
+    a << "-f" << (isMov ? "mov" : "mp4") << path;
+    return a;
+}
+
+bool FfmpegPipeEncoder::open(const QString &path, cv::Size size, double fps, bool isMov) {
+    QString exe = m_settings.ffmpegPath.isEmpty() ? QStandardPaths::findExecutable("ffmpeg") : m_settings.ffmpegPath;
+    if (exe.isEmpty()) { m_error = "未找到 ffmpeg"; return false; }
+    m_size = size;
+    QStringList args = buildArgs(m_settings, path, size, fps, isMov);
+#ifdef Q_OS_UNIX
+    QMutexLocker spawnLock(&g_spawnMutex);
+    int fds[2]; if (!cloexecPipe(fds)) { m_error = "无法创建管道"; return false; }
+#ifdef Q_OS_LINUX
+    ::fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+#endif
+    QList<QByteArray> argBytes; argBytes << QFile::encodeName(exe); for (const QString &s : args) argBytes << s.toLocal8Bit();
+    std::vector<char*> argv; for (QByteArray &b : argBytes) argv.push_back(b.data()); argv.push_back(nullptr);
+    posix_spawn_file_actions_t fa; posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fds[0], STDIN_FILENO); posix_spawn_file_actions_addclose(&fa, fds[0]);
+    pid_t pid; int rc = posix_spawnp(&pid, argBytes[0].constData(), &fa, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fa); ::close(fds[0]); spawnLock.unlock();
+    if (rc != 0) { ::close(fds[1]); m_error = "无法启动 ffmpeg: " + exe; return false; }
+    m_fd = fds[1]; m_pid = pid;
+#else
+    m_proc = new QProcess; m_proc->setProcessChannelMode(QProcess::ForwardedErrorChannel); m_proc->setStandardOutputFile(QProcess::nullDevice());
+    m_proc->start(exe, args);
+    if (!m_proc->waitForStarted()) { m_error = "无法启动 ffmpeg: " + exe; delete m_proc; m_proc = nullptr; return false; }
+#endif
+    qDebug() << "ffmpeg encoder:" << args.join(' ');
+    return true;
+}
+
+bool FfmpegPipeEncoder::writeBytes(const uchar *data, size_t len) {
+#ifdef Q_OS_UNIX
+    SigPipeBlock block;
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EPIPE) block.sawEpipe();
+        if (n <= 0) { m_error = "ffmpeg 管道已关闭"; return false; }
+        data += n; len -= (size_t)n;
+    }
+    return true;
+#else
+    if (m_proc->write((const char*)data, (qint64)len) != (qint64)len) { m_error = "ffmpeg 管道写入失败"; return false; }
+    while (m_proc->bytesToWrite() > (8 << 20)) if (!m_proc->waitForBytesWritten(-1)) { m_error = "ffmpeg 管道已关闭"; return false; } // 背压：最多缓冲约 8 MB
+    return true;
+#endif
+}
+
+bool FfmpegPipeEncoder::write(const cv::Mat &frame) {
+#ifdef Q_OS_UNIX
+    if (m_fd < 0) return false;
+#else
+    if (!m_proc) return false;
+#endif
+    CV_Assert(frame.type() == CV_8UC3 && frame.size() == m_size);
+    // 连续帧一次写出整块缓冲；ROI 等非连续帧逐行写
+    if (frame.isContinuous()) return writeBytes(frame.data, frame.total() * frame.elemSize());
+    for (int y = 0; y < frame.rows; ++y) if (!writeBytes(frame.ptr(y), (size_t)frame.cols * frame.elemSize())) return false;
+    return true;
+}
+
+bool FfmpegPipeEncoder::close() {
+#ifdef Q_OS_UNIX
+    if (m_pid < 0) return true;
+    if (m_fd >= 0) { ::close(m_fd); m_fd = -1; } // EOF：ffmpeg 写完尾部后退出
+    int status = 0; while (::waitpid((pid_t)m_pid, &status, 0) < 0 && errno == EINTR) {}
+    m_pid = -1;
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+    if (!m_proc) return true;
+    m_proc->closeWriteChannel(); m_proc->waitForFinished(-1);
+    bool ok = m_proc->exitStatus() == QProcess::NormalExit && m_proc->exitCode() == 0;
+    delete m_proc; m_proc = nullptr;
+#endif
+    if (!ok) m_error = "ffmpeg 编码失败";
+    return ok;
+}
@@ -0,0 +1,86 @@
+#ifndef VIDEOENCODER_H
+#define VIDEOENCODER_H
+
+#include <QString>
+#include <QStringList>
+
+// OpenCV
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+class QProcess;
+
+// --- 编码器设置 ---
+// OpenCV 后端只用到容器(由输出路径后缀决定)；其余字段只对 ffmpeg 管道后端生效
+struct EncoderSettings {
+    enum Backend { OpenCV, FFmpegPipe };
+    Backend backend = OpenCV;
+    QString ffmpegPath;             // 空 = 在 PATH 中查找
+    QString codec = "libx264";
+    QString preset = "veryfast";    // 空 = 编码器默认
+    int crf = 18;                   // bitrateKbps > 0 时忽略
+    int bitrateKbps = 0;
+    int threads = 0;                // 0 = 编码器自选
+    QString pixFmt = "yuv420p";
+
+    static Backend backendFromString(const QString &name) { return name.compare("ffmpeg", Qt::CaseInsensitive) == 0 ? FFmpegPipe : OpenCV; }
+};
+
+// --- 编码器后端 ---
+// write 只接收 open 时尺寸的 CV_8UC3 (BGR) 帧；缩放与量化由 VideoWriterWorker 完成
+class VideoEncoder {
+public:
+    virtual ~VideoEncoder() {}
+    virtual bool open(const QString &path, cv::Size size, double fps, bool isMov) = 0;
+    virtual bool write(const cv::Mat &frame) = 0;
+    // 结束编码并等待文件写完；返回 false 表示编码器异常退出
+    virtual bool close() = 0;
+    virtual const char *name() const = 0;
+    QString lastError() const { return m_error; }
+
+    static VideoEncoder *create(const EncoderSettings &settings);
+
+protected:
+    QString m_error;
+};
+
+// cv::VideoWriter (avc1)，容器由路径后缀决定
+class OpenCvEncoder : public VideoEncoder {
+public:
+    bool open(const QString &path, cv::Size size, double fps, bool isMov) override;
+    bool write(const cv::Mat &frame) override;
+    bool close() override;
+    const char *name() const override { return "opencv"; }
+
+private:
+    cv::VideoWriter m_writer;
+};
+
+// 原始 BGR 帧经管道送入本地 ffmpeg 进程。
+// Unix 下直接 write() 帧缓冲到管道(不经过中间缓冲)，Linux 另把管道容量调到 1 MB 减少唤醒次数；其他平台走 QProcess
+class FfmpegPipeEncoder : public VideoEncoder {
+public:
+    explicit FfmpegPipeEncoder(const EncoderSettings &settings);
+    ~FfmpegPipeEncoder();
+    bool open(const QString &path, cv::Size size, double fps, bool isMov) override;
+    bool write(const cv::Mat &frame) override;
+    bool close() override;
+    const char *name() const override { return "ffmpeg"; }
+
+    // 完整的 ffmpeg 参数(不含程序名)
+    static QStringList buildArgs(const EncoderSettings &settings, const QString &path, cv::Size size, double fps, bool isMov);
+
+private:
+    bool writeBytes(const uchar *data, size_t len);
+
+    EncoderSettings m_settings;
+    cv::Size m_size;
+#ifdef Q_OS_UNIX
+    int m_fd;
+    qint64 m_pid;
+#else
+    QProcess *m_proc;
+#endif
+};
+
+#endif // VIDEOENCODER_H
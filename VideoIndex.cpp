@@ -0,0 +1,199 @@
+#include "VideoIndex.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QThreadPool>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <vector>
+
+// 原始包模式与关键帧标记需要 OpenCV 4.6+ 的 FFmpeg 后端
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+#define STARTRAILS_VIDEO_INDEX 1
+#endif
+
+namespace {
+const int kIndexVersion = 1;
+
+struct Entry {
+    QSharedPointer<const VideoIndex> index;
+    bool building = false;
+    bool failed = false;
+};
+
+QMutex g_registryMutex;
+QWaitCondition g_built;
+QHash<QString, Entry> g_registry;
+std::atomic<bool> g_cancel{false}; // 程序退出时中止后台扫描，不拖住全局线程池
+}
+
+// ================= VideoIndex Implementation =================
+int VideoIndex::keyframeAtOrBefore(int frame) const {
+    if (frame < 0 || m_keys.isEmpty()) return -1;
+    auto it = std::upper_bound(m_keys.begin(), m_keys.end(), frame);
+    return it == m_keys.begin() ? -1 : *(it - 1);
+}
+
+int VideoIndex::frameAtPts(double ms) const {
+    int hi = (int)(std::lower_bound(m_pts.begin(), m_pts.end(), ms) - m_pts.begin());
+    int best = -1; double bestDiff = m_halfFrame;
+    for (int c : {hi - 1, hi}) {
+        if (c < 0 || c >= m_pts.size()) continue;
+        double d = std::abs(m_pts[c] - ms); if (d <= bestDiff) { bestDiff = d; best = c; }
+    }
+    return best;
+}
+
+// 缓存文件名由素材名、大小和修改时间决定，素材变化后自动失效
+QString VideoIndex::cachePath(const QString &path) {
+    QFileInfo src(path);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(src.fileName().toUtf8()); hash.addData(QByteArray::number(src.size())); hash.addData(QByteArray::number(src.lastModified().toMSecsSinceEpoch()));
+    return src.dir().filePath(".startrails_proxy/" + src.completeBaseName() + "_" + hash.result().toHex().left(12) + ".index.json");
+}
+
+QSharedPointer<const VideoIndex> VideoIndex::get(const QString &path, bool wait) {
+#ifdef STARTRAILS_VIDEO_INDEX
+    QString key = QFileInfo(path).absoluteFilePath();
+    QMutexLocker l(&g_registryMutex);
+    if (!g_registry.contains(key)) {
+        static bool hooked = false; if (!hooked) { hooked = true; qAddPostRoutine([]() { g_cancel = true; }); }
+        Entry &e = g_registry[key];
+        QSharedPointer<VideoIndex> cached(new VideoIndex);
+        if (cached->load(cachePath(key))) e.index = cached;
+        else {
+            e.building = true;
+            QThreadPool::globalInstance()->start([key]() {
+                QSharedPointer<VideoIndex> idx(new VideoIndex); bool ok = idx->build(key);
+                if (ok) idx->save(cachePath(key));
+                QMutexLocker l(&g_registryMutex); Entry &e = g_registry[key];
+                e.building = false; e.failed = !ok; if (ok) e.index = idx;
+                g_built.wakeAll();
+            });
+        }
+    }
+    while (wait && g_registry.value(key).building) g_built.wait(&g_registryMutex);
+    return g_registry.value(key).index;
+#else
+    Q_UNUSED(path); Q_UNUSED(wait);
+    return QSharedPointer<const VideoIndex>();
+#endif
+}
+
+// 原始包模式只解复用不解码；包按解码顺序到达(有 B 帧时时间戳乱序)，排序后即为显示顺序
+bool VideoIndex::build(const QString &path) {
+#ifdef STARTRAILS_VIDEO_INDEX
+    cv::VideoCapture cap;
+    try { if (!cap.open(path.toStdString(), cv::CAP_FFMPEG, {cv::CAP_PROP_FORMAT, -1})) return false; } catch (...) { return false; }
+    std::vector<double> pts, keyPts;
+    while (!g_cancel && cap.grab()) {
+        double t = cap.get(cv::CAP_PROP_POS_MSEC); pts.push_back(t);
+        if (cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0) keyPts.push_back(t);
+    }
+    if (g_cancel || pts.size() < 2 || keyPts.empty()) return false;
+    std::sort(pts.begin(), pts.end());
+    m_pts = QVector<double>(pts.begin(), pts.end());
+    m_keys = {0}; // 开放 GOP 的前导帧只能从文件开头解码得到
+    for (double k : keyPts) m_keys << (int)(std::lower_bound(pts.begin(), pts.end(), k) - pts.begin());
+    std::sort(m_keys.begin(), m_keys.end()); m_keys.erase(std::unique(m_keys.begin(), m_keys.end()), m_keys.end());
+    m_halfFrame = (pts.back() - pts.front()) / (pts.size() - 1) / 2;
+    qDebug() << "Video index:" << path << m_pts.size() << "frames," << m_keys.size() << "keyframes";
+    return true;
+#else
+    Q_UNUSED(path); return false;
+#endif
+}
+
+bool VideoIndex::load(const QString &file) {
+    QFile f(file); if (!f.open(QIODevice::ReadOnly)) return false;
+    QJsonObject o = QJsonDocument::fromJson(f.readAll()).object();
+    if (o.value("version").toInt() != kIndexVersion) return false;
+    for (const QJsonValue &v : o.value("pts").toArray()) m_pts << v.toDouble();
+    for (const QJsonValue &v : o.value("keyframes").toArray()) m_keys << v.toInt();
+    m_halfFrame = o.value("halfFrame").toDouble();
+    return m_pts.size() >= 2 && !m_keys.isEmpty() && m_keys.first() == 0;
+}
+
+void VideoIndex::save(const QString &file) const {
+    if (!QDir().mkpath(QFileInfo(file).absolutePath())) return;
+    QJsonArray pts; for (double t : m_pts) pts.append(t);
+    QJsonArray keys; for (int k : m_keys) keys.append(k);
+    QSaveFile f(file);
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(QJsonDocument(QJsonObject{{"version", kIndexVersion}, {"halfFrame", m_halfFrame}, {"keyframes", keys}, {"pts", pts}}).toJson(QJsonDocument::Compact));
+        if (!f.commit()) qDebug() << "Video index write failed:" << file;
+    }
+}
+
+// ================= VideoFrameReader Implementation =================
+VideoFrameReader::VideoFrameReader(const QString &path, int cacheMB) : m_path(path), m_cap(path.toStdString()), m_pos(0), m_pending(false), m_cacheFrames(0) {
+    if (!m_cap.isOpened()) return;
+    m_index = VideoIndex::get(path); // 未就绪时触发后台建立
+    double frameBytes = std::max(1.0, m_cap.get(cv::CAP_PROP_FRAME_WIDTH) * m_cap.get(cv::CAP_PROP_FRAME_HEIGHT) * 3);
+    if (cacheMB > 0) m_cacheFrames = std::max(2, std::min(64, (int)(cacheMB * 1048576.0 / frameBytes)));
+}
+
+bool VideoFrameReader::read(cv::Mat &frame) {
+    bool ok = m_pending ? m_cap.retrieve(frame) : m_cap.read(frame);
+    m_pending = false; if (ok) m_pos++;
+    return ok;
+}
+
+bool VideoFrameReader::seek(int frame) { return seekTo(frame, false); }
+
+bool VideoFrameReader::seekTo(int frame, bool fillCache) {
+    if (frame < 0) return false;
+    if (frame == m_pos) return true;
+    if (!m_index) m_index = VideoIndex::get(m_path);
+    if (!m_index || frame >= m_index->frames()) { m_pending = false; m_pos = frame; return m_cap.set(cv::CAP_PROP_POS_FRAMES, frame); }
+
+    const VideoIndex &idx = *m_index;
+    int cur = m_pending ? m_pos : m_pos - 1; // 最后一个已 grab 的帧
+    // 目标在当前位置之后且中间没有关键帧：直接向前解码，不 seek
+    if (!(frame > cur && idx.keyframeAtOrBefore(frame) <= cur)) {
+        cur = -1;
+        for (int key = idx.keyframeAtOrBefore(frame), attempt = 0; key >= 0 && attempt < 3; ++attempt) {
+            m_cap.set(cv::CAP_PROP_POS_FRAMES, key);
+            if (!m_cap.grab()) break;
+            int landed = idx.frameAtPts(m_cap.get(cv::CAP_PROP_POS_MSEC));
+            if (landed < 0 && key == 0) landed = 0;
+            if (landed >= 0 && landed <= frame) { cur = landed; break; }
+            key = key == 0 ? -1 : idx.keyframeAtOrBefore(key - 1); // 落点偏后或无法识别：退到更早的关键帧
+        }
+        if (cur < 0) { qDebug() << "Indexed seek failed, falling back:" << m_path << frame; m_pending = false; m_pos = frame; return m_cap.set(cv::CAP_PROP_POS_FRAMES, frame); }
+        if (fillCache && frame - cur < m_cacheFrames && cur < frame) { cv::Mat f; if (m_cap.retrieve(f)) remember(cur, f); }
+    }
+    while (cur < frame) {
+        if (!m_cap.grab()) { m_pending = false; m_pos = cur + 1; return false; }
+        if (++cur < frame && fillCache && frame - cur < m_cacheFrames) { cv::Mat f; if (m_cap.retrieve(f)) remember(cur, f); }
+    }
+    m_pos = frame; m_pending = true;
+    return true;
+}
+
+bool VideoFrameReader::frameAt(int frame, cv::Mat &out) {
+    for (int i = 0; i < m_cache.size(); ++i) if (m_cache[i].first == frame) { m_cache.move(i, 0); out = m_cache.first().second; return true; }
+    cv::Mat f; // 新缓冲：read 会复用传入 Mat 的内存，不能覆盖缓存中的帧
+    if (!seekTo(frame, m_cacheFrames > 0) || !read(f)) return false;
+    remember(frame, f); out = f;
+    return true;
+}
+
+void VideoFrameReader::remember(int frame, const cv::Mat &image) {
+    if (m_cacheFrames <= 0) return;
+    for (int i = 0; i < m_cache.size(); ++i) if (m_cache[i].first == frame) { m_cache.removeAt(i); break; }
+    m_cache.prepend(qMakePair(frame, image));
+    while (m_cache.size() > m_cacheFrames) m_cache.removeLast();
+}
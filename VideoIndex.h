@@ -0,0 +1,68 @@
+#ifndef VIDEOINDEX_H
+#define VIDEOINDEX_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include <QSharedPointer>
+
+// OpenCV
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+// --- 视频关键帧索引 ---
+// 后台线程以 FFmpeg 原始包模式(不解码)扫一遍视频，记录每帧的显示时间戳与关键帧位置，
+// 缓存在素材旁的 .startrails_proxy 目录。长 GOP 的 MP4/MOV 用 CAP_PROP_POS_FRAMES 定位既慢又可能落错帧，
+// 有了索引后定位到目标之前最近的关键帧，按时间戳确认落点，再向前解码到目标帧。
+class VideoIndex {
+public:
+    int frames() const { return m_pts.size(); }
+    // frame 之前(含)最近的关键帧，frame < 0 时返回 -1
+    int keyframeAtOrBefore(int frame) const;
+    // 解码器给出的时间戳(ms)对应的帧号，与所有帧都相差超过半帧时返回 -1
+    int frameAtPts(double ms) const;
+
+    // 取 path 的索引：内存或磁盘缓存命中时立即返回，否则在后台建立并返回空指针；
+    // wait = true 时等后台建立完成。OpenCV 不支持原始包模式或建立失败时始终返回空指针
+    static QSharedPointer<const VideoIndex> get(const QString &path, bool wait = false);
+
+private:
+    bool build(const QString &path);
+    bool load(const QString &file);
+    void save(const QString &file) const;
+    static QString cachePath(const QString &path);
+
+    QVector<double> m_pts;   // 按显示顺序
+    QVector<int> m_keys;     // 关键帧的帧号，升序，总是包含 0
+    double m_halfFrame = 0;
+};
+
+// --- 按帧号读取视频 ---
+// 顺序读取与 cv::VideoCapture 相同；seek 有索引时精确定位，索引未就绪时退回 CAP_PROP_POS_FRAMES。
+// cacheMB > 0 时 frameAt 保留最近解码的帧(含定位途中解出的目标前几帧)，来回拖动时间轴不再重复解码
+class VideoFrameReader {
+public:
+    explicit VideoFrameReader(const QString &path, int cacheMB = 0);
+    bool isOpened() const { return m_cap.isOpened(); }
+    double get(int prop) const { return m_cap.get(prop); }
+    // 之后 read 返回第 frame 帧
+    bool seek(int frame);
+    bool read(cv::Mat &frame);
+    // 随机取帧，返回的图像与缓存共享数据，调用方需要修改时先 clone
+    bool frameAt(int frame, cv::Mat &out);
+
+private:
+    bool seekTo(int frame, bool fillCache);
+    void remember(int frame, const cv::Mat &image);
+
+    QString m_path;
+    cv::VideoCapture m_cap;
+    QSharedPointer<const VideoIndex> m_index;
+    int m_pos;          // 下一次 read 返回的帧号
+    bool m_pending;     // 第 m_pos 帧已 grab、尚未 retrieve
+    int m_cacheFrames;
+    QList<QPair<int, cv::Mat>> m_cache;   // 最近使用的在前
+};
+
+#endif // VIDEOINDEX_H
@@ -1,8 +1,14 @@
-#include "mainwindow.h"
+#include "MainWindow.h"
+#include "HeadlessRunner.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // 命令行模式：不创建任何窗口，适用于无显示器的渲染服务器
+    for (int i = 1; i < argc; ++i) {
+        if (QString(argv[i]) == "--headless") { QCoreApplication a(argc, argv); return HeadlessRunner::run(a.arguments()); }
+    }
+
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
@@ -0,0 +1,17 @@
+# --- OpenCV 配置 (StarTrails.pro 与 StarTrailsBench.pro 共用) ---
+
+# 1. 头文件路径 (请确认路径存在)
+INCLUDEPATH += D:/opencv/build/include
+
+# 2. 库文件路径
+LIBS += -LD:/opencv/build/x64/vc16/lib
+
+# 3. 智能链接：Debug 模式链 debug 库，Release 模式链 release 库
+# 请务必根据你实际的文件名修改版本号 (例如 4100, 460, 480)
+CONFIG(debug, debug|release) {
+    # Debug 模式 (带 d)
+    LIBS += -lopencv_world4120d
+} else {
+    # Release 模式 (不带 d)
+    LIBS += -lopencv_world4120
+}